@@ -0,0 +1,338 @@
+// Allocation-counting test harness
+// Interposes operator new / malloc and verifies the steady-state hot path
+// (submit, cancel, amend) performs zero heap allocations after warmup, and that a
+// book given its own arena never touches the global heap at all
+
+#include "order_book.hpp"
+#include "async_book.hpp"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <atomic>
+#include <cstdlib>
+#include <cerrno>
+#include <new>
+#include <thread>
+
+// ---------------------------------------------------------------------------
+// Allocation interposition
+// ---------------------------------------------------------------------------
+
+namespace {
+    std::atomic<bool>     g_counting{false};
+    std::atomic<uint64_t> g_allocCount{0};
+    std::atomic<uint64_t> g_allocBytes{0};
+
+    inline void recordAllocation(size_t bytes) {
+        if (g_counting.load(std::memory_order_relaxed)) {
+            g_allocCount.fetch_add(1, std::memory_order_relaxed);
+            g_allocBytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+    }
+}
+
+#if defined(__GLIBC__)
+// On glibc every allocation funnels through malloc, so count there and let
+// operator new fall through to it
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* ptr, size_t size);
+    void* __libc_memalign(size_t alignment, size_t size);
+    void  __libc_free(void* ptr);
+
+    void* malloc(size_t size) {
+        recordAllocation(size);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) {
+        recordAllocation(count * size);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* ptr, size_t size) {
+        recordAllocation(size);
+        return __libc_realloc(ptr, size);
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size) {
+        recordAllocation(size);
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** out, size_t alignment, size_t size) {
+        recordAllocation(size);
+        *out = __libc_memalign(alignment, size);
+        return *out ? 0 : ENOMEM;
+    }
+
+    void free(void* ptr) {
+        __libc_free(ptr);
+    }
+}
+#define COUNT_IN_OPERATOR_NEW(bytes) ((void)0)
+#else
+#define COUNT_IN_OPERATOR_NEW(bytes) recordAllocation(bytes)
+#endif
+
+void* operator new(size_t size) {
+    COUNT_IN_OPERATOR_NEW(size);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    COUNT_IN_OPERATOR_NEW(size);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+    COUNT_IN_OPERATOR_NEW(size);
+    size_t a = static_cast<size_t>(align);
+    if (void* p = std::aligned_alloc(a, (size + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t align) {
+    return operator new(size, align);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+// ---------------------------------------------------------------------------
+// Test driver
+// ---------------------------------------------------------------------------
+
+class AllocationTest {
+private:
+    static constexpr int      WARMUP_OPS    = 1000000;
+    static constexpr int      MEASURED_OPS  = 200000;
+    static constexpr size_t   MAX_RESTING   = 5000;
+    static constexpr int64_t  MID_TICK      = 50000;
+    static constexpr int      PRICE_SPREAD  = 32;
+
+    struct OpCounter {
+        const char* name;
+        uint64_t calls = 0;
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+    };
+
+    OrderBook ob_;
+    std::mt19937_64 rng_;
+    std::vector<uint64_t> live_;
+    std::vector<Fill> fills_;
+    uint64_t nextId_ = 1;
+
+    OpCounter submit_{"submit"};
+    OpCounter cancel_{"cancel"};
+    OpCounter amend_{"amend"};
+
+public:
+    AllocationTest() : ob_(MAX_RESTING * 4), rng_(42) {
+        live_.reserve(MAX_RESTING * 2);
+        fills_.reserve(4096);
+    }
+
+    bool run() {
+        std::cout << "Warming up with " << WARMUP_OPS << " operations...\n";
+        for (int i = 0; i < WARMUP_OPS; ++i) step(false);
+
+        std::cout << "Measuring " << MEASURED_OPS << " operations...\n";
+        g_counting.store(true);
+        for (int i = 0; i < MEASURED_OPS; ++i) step(true);
+        g_counting.store(false);
+
+        std::cout << "\n" << std::left << std::setw(10) << "Operation"
+                  << std::right << std::setw(12) << "Calls"
+                  << std::setw(14) << "Allocations"
+                  << std::setw(12) << "Bytes" << "\n";
+
+        bool ok = true;
+        for (const OpCounter* c : {&submit_, &cancel_, &amend_}) {
+            std::cout << std::left << std::setw(10) << c->name
+                      << std::right << std::setw(12) << c->calls
+                      << std::setw(14) << c->allocations
+                      << std::setw(12) << c->bytes << "\n";
+            if (c->allocations != 0) ok = false;
+        }
+
+        std::cout << "\nResting orders at end: " << live_.size() << "\n";
+        return ok;
+    }
+
+private:
+    // Runs one random operation, recording allocations made by the book call only
+    void step(bool measure) {
+        int op = static_cast<int>(rng_() % 10);
+
+        if (op < 2 && !live_.empty()) {
+            size_t idx = rng_() % live_.size();
+            uint64_t id = live_[idx];
+            timed(cancel_, measure, [&] { ob_.cancelOrder(id); });
+            live_[idx] = live_.back();
+            live_.pop_back();
+        } else if (op < 4 && !live_.empty()) {
+            uint64_t id = live_[rng_() % live_.size()];
+            int64_t price = randomPrice(rng_() & 1 ? Side::Buy : Side::Sell);
+            uint32_t qty = 1 + static_cast<uint32_t>(rng_() % 100);
+            fills_.clear();
+            timed(amend_, measure, [&] { ob_.modifyOrder(id, price, qty, &fills_); });
+        } else {
+            Side side = (rng_() & 1) ? Side::Buy : Side::Sell;
+            TimeInForce tif = (rng_() % 8 == 0) ? TimeInForce::IOC : TimeInForce::GTC;
+            Order order{nextId_++, side, randomPrice(side), 1 + static_cast<uint32_t>(rng_() % 100),
+                        OrderType::Limit, tif, static_cast<uint32_t>(rng_() % 16), 0};
+            fills_.clear();
+            timed(submit_, measure, [&] { ob_.submitOrder(order, &fills_); });
+            if (tif == TimeInForce::GTC) live_.push_back(order.id);
+        }
+
+        // Keep the resting population bounded so warmup reaches steady state
+        while (live_.size() > MAX_RESTING) {
+            timed(cancel_, measure, [&] { ob_.cancelOrder(live_.front()); });
+            live_.front() = live_.back();
+            live_.pop_back();
+        }
+    }
+
+    template<typename Fn>
+    void timed(OpCounter& counter, bool measure, Fn&& fn) {
+        uint64_t allocsBefore = g_allocCount.load(std::memory_order_relaxed);
+        uint64_t bytesBefore = g_allocBytes.load(std::memory_order_relaxed);
+        fn();
+        if (measure) {
+            counter.calls++;
+            counter.allocations += g_allocCount.load(std::memory_order_relaxed) - allocsBefore;
+            counter.bytes += g_allocBytes.load(std::memory_order_relaxed) - bytesBefore;
+        }
+    }
+
+    // Prices straddle the mid so a fraction of orders cross the spread
+    int64_t randomPrice(Side side) {
+        int64_t offset = static_cast<int64_t>(rng_() % PRICE_SPREAD) - PRICE_SPREAD / 4;
+        return (side == Side::Buy) ? MID_TICK - offset : MID_TICK + offset;
+    }
+};
+
+// A book given its own arena must take every byte from it: construction, a cold
+// start of trading and destruction run without a single global heap allocation
+bool arenaBookStaysInArena() {
+    constexpr size_t ARENA_BYTES = 64 << 20;
+    constexpr int    OPS = 100000;
+    constexpr int    MAX_LIVE = 5000;
+
+    ArenaResource arena(ARENA_BYTES);
+    std::vector<Fill> fills;
+    fills.reserve(4096);
+    std::mt19937_64 rng(7);
+
+    g_allocCount.store(0);
+    g_counting.store(true);
+    {
+        OrderBook ob(MAX_LIVE * 4, &arena);
+        for (int i = 0; i < OPS; ++i) {
+            Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+            int64_t offset = static_cast<int64_t>(rng() % 32) - 8;
+            Order order{uint64_t(i + 1), side, (side == Side::Buy) ? 50000 - offset : 50000 + offset,
+                        1 + static_cast<uint32_t>(rng() % 100), OrderType::Limit, TimeInForce::GTC,
+                        static_cast<uint32_t>(rng() % 16), 0};
+            fills.clear();
+            ob.submitOrder(order, &fills);
+            if (i >= MAX_LIVE) ob.cancelOrder(uint64_t(i + 1 - MAX_LIVE));
+        }
+    }
+    g_counting.store(false);
+
+    uint64_t globalAllocs = g_allocCount.load();
+    std::cout << "Arena-backed book: " << OPS << " ops from a cold start, "
+              << arena.bytesUsed() / 1024 << " KB of arena used, "
+              << arena.overflowBytes() << " bytes overflowed, "
+              << globalAllocs << " global allocations\n";
+    return globalAllocs == 0 && arena.overflowBytes() == 0;
+}
+
+// One in-flight client: alternately rests and crosses, then cancels what is left
+AsyncTask asyncClient(AsyncBook& book, uint64_t firstId, int rounds, std::vector<Fill>& fills, int& finished) {
+    for (int i = 0; i < rounds; ++i) {
+        uint64_t id = firstId + uint64_t(i);
+        Side side = (id & 1) ? Side::Buy : Side::Sell;
+        int64_t price = 50000 + static_cast<int64_t>(id % 16) - 8;
+        co_await book.submit({id, side, price, 10, OrderType::Limit, TimeInForce::GTC, uint32_t(id % 7), 0}, &fills);
+        co_await book.cancel(id);
+    }
+    ++finished;
+}
+
+// co_await submit/cancel from thousands of coroutines: once frames and the book's
+// pools are warm, neither the client nor the matching thread touches the heap
+bool asyncBookIsAllocationFree() {
+    constexpr int CLIENTS = 2048;
+    constexpr int ROUNDS = 32;
+
+    AsyncBook book(CLIENTS * 4);
+    std::vector<std::vector<Fill>> fills(CLIENTS);
+    for (auto& clientFills : fills) clientFills.reserve(64);
+
+    auto runClients = [&](int rounds, uint64_t firstId) {
+        int finished = 0;
+        for (int c = 0; c < CLIENTS; ++c) {
+            asyncClient(book, firstId + uint64_t(c) * uint64_t(rounds), rounds, fills[c], finished);
+        }
+        while (finished < CLIENTS) {
+            if (book.drain() == 0) std::this_thread::yield();
+        }
+    };
+
+    runClients(ROUNDS, 1);   // Warmup with the same shape
+    FramePool::Stats before = FramePool::threadStats();
+
+    g_allocCount.store(0);
+    g_counting.store(true);
+    runClients(ROUNDS, 1 + uint64_t(CLIENTS) * ROUNDS);
+    g_counting.store(false);
+
+    FramePool::Stats after = FramePool::threadStats();
+    uint64_t globalAllocs = g_allocCount.load();
+    std::cout << "Async book: " << CLIENTS << " coroutines, " << uint64_t(CLIENTS) * ROUNDS * 2
+              << " awaited ops, " << (after.reused - before.reused) << " frames reused, "
+              << (after.fresh - before.fresh) << " fresh, "
+              << globalAllocs << " global allocations\n";
+    return globalAllocs == 0 && after.fresh == before.fresh;
+}
+
+int main() {
+    std::cout << "=== HOT PATH ALLOCATION TEST ===\n\n";
+
+    AllocationTest test;
+    bool ok = test.run();
+
+    if (!ok) {
+        std::cout << "\n=== FAILED: hot path allocated after warmup ===\n";
+        return 1;
+    }
+
+    std::cout << "\n";
+    if (!arenaBookStaysInArena()) {
+        std::cout << "\n=== FAILED: arena-backed book allocated outside its arena ===\n";
+        return 1;
+    }
+
+    if (!asyncBookIsAllocationFree()) {
+        std::cout << "\n=== FAILED: async submit allocated after warmup ===\n";
+        return 1;
+    }
+
+    std::cout << "\n=== ZERO ALLOCATIONS ON HOT PATH ===\n";
+    return 0;
+}
@@ -0,0 +1,205 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include "numa_placement.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define ARENA_HAS_MMAP 1
+#endif
+
+// Memory resources for giving each order book its own memory.
+//
+// ArenaResource reserves one contiguous block up front and hands it out by bumping
+// a pointer; individual deallocations are ignored and everything is returned when
+// the arena is destroyed. Requests that no longer fit spill over to the upstream
+// resource (and are freed normally). OrderBook recycles its nodes internally, so a
+// book running on an arena stops consuming arena space once it reaches steady state.
+//
+// With ArenaOptions the block is mapped directly from the OS instead: optionally on
+// 2 MB huge pages (MAP_HUGETLB, falling back to transparent huge pages via madvise,
+// then to regular pages), optionally bound to a NUMA node, and optionally pre-faulted
+// so no page fault or zero-fill happens on first touch during trading.
+//
+// ArenaPool layers size-class free lists over an arena, for owners that allocate and
+// free repeatedly without recycling themselves. Neither resource is thread-safe:
+// give each book (or each thread) its own.
+
+// How an arena's block was actually obtained
+enum class ArenaBacking : uint8_t {
+    Heap,             // From the upstream resource
+    Pages,            // Anonymous mapping, regular pages
+    TransparentHuge,  // Anonymous mapping advised MADV_HUGEPAGE (kernel may still use 4 KB pages)
+    HugeTlb           // Explicit 2 MB pages from the hugetlb pool
+};
+
+inline const char* arenaBackingName(ArenaBacking backing) {
+    switch (backing) {
+        case ArenaBacking::Pages:           return "4 KB pages";
+        case ArenaBacking::TransparentHuge: return "transparent huge pages";
+        case ArenaBacking::HugeTlb:         return "2 MB hugetlb pages";
+        default:                            return "heap";
+    }
+}
+
+struct ArenaOptions {
+    bool hugePages = false;   // Request 2 MB pages (best effort)
+    bool prefault  = false;   // Touch every page up front
+    int  numaNode  = -1;      // Preferred node for the block (-1: first-touch default)
+};
+
+class ArenaResource : public std::pmr::memory_resource {
+public:
+    explicit ArenaResource(size_t capacity,
+                           std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream_(upstream), capacity_(capacity) {
+        if (capacity_ > 0) {
+            base_ = static_cast<std::byte*>(upstream_->allocate(capacity_, alignof(std::max_align_t)));
+        }
+    }
+
+    ArenaResource(size_t capacity, const ArenaOptions& options,
+                  std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream_(upstream), capacity_(capacity) {
+        map(options.hugePages);
+        // Bind before the first touch so pages are faulted in on the requested node
+        if (options.numaNode >= 0 && backing_ != ArenaBacking::Heap) {
+            numaBound_ = HFTNuma::bindMemory(base_, capacity_, options.numaNode);
+        }
+        if (options.prefault) prefault();
+    }
+
+    ~ArenaResource() override {
+        if (!base_) return;
+#ifdef ARENA_HAS_MMAP
+        if (backing_ != ArenaBacking::Heap) {
+            munmap(base_, capacity_);
+            return;
+        }
+#endif
+        upstream_->deallocate(base_, capacity_, alignof(std::max_align_t));
+    }
+
+    ArenaResource(const ArenaResource&) = delete;
+    ArenaResource& operator=(const ArenaResource&) = delete;
+
+    static constexpr size_t HUGE_PAGE_BYTES = 2 << 20;
+    static constexpr size_t BASE_PAGE_BYTES = 4096;
+
+    ArenaBacking backing() const { return backing_; }
+    bool prefaulted() const { return prefaulted_; }
+    bool numaBound() const { return numaBound_; }
+    const void* data() const { return base_; }
+    size_t capacity() const { return capacity_; }
+    size_t bytesUsed() const { return used_; }
+    size_t overflowBytes() const { return overflowBytes_; }   // Currently held from upstream
+    bool contains(const void* p) const {
+        auto* b = static_cast<const std::byte*>(p);
+        return b >= base_ && b < base_ + capacity_;
+    }
+
+private:
+    void map(bool hugePages) {
+#ifdef ARENA_HAS_MMAP
+        if (capacity_ == 0) return;
+        const int prot = PROT_READ | PROT_WRITE;
+        const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+        if (hugePages) {
+            capacity_ = (capacity_ + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+#ifdef MAP_HUGETLB
+            void* p = mmap(nullptr, capacity_, prot, flags | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) {
+                base_ = static_cast<std::byte*>(p);
+                backing_ = ArenaBacking::HugeTlb;
+                return;
+            }
+#endif
+        }
+        void* p = mmap(nullptr, capacity_, prot, flags, -1, 0);
+        if (p == MAP_FAILED) {
+            base_ = static_cast<std::byte*>(upstream_->allocate(capacity_, alignof(std::max_align_t)));
+            return;
+        }
+        base_ = static_cast<std::byte*>(p);
+        backing_ = ArenaBacking::Pages;
+#ifdef MADV_HUGEPAGE
+        if (hugePages && madvise(p, capacity_, MADV_HUGEPAGE) == 0) {
+            backing_ = ArenaBacking::TransparentHuge;
+        }
+#endif
+#else
+        (void)hugePages;
+        if (capacity_ > 0) {
+            base_ = static_cast<std::byte*>(upstream_->allocate(capacity_, alignof(std::max_align_t)));
+        }
+#endif
+    }
+
+    void prefault() {
+        volatile std::byte* bytes = base_;
+        for (size_t offset = 0; offset < capacity_; offset += BASE_PAGE_BYTES) {
+            bytes[offset] = std::byte{0};
+        }
+        prefaulted_ = true;
+    }
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        uintptr_t start = reinterpret_cast<uintptr_t>(base_) + used_;
+        size_t padding = (alignment - start % alignment) % alignment;
+        if (base_ && used_ + padding + bytes <= capacity_) {
+            used_ += padding + bytes;
+            return reinterpret_cast<void*>(start + padding);
+        }
+        void* p = upstream_->allocate(bytes, alignment);
+        overflowBytes_ += bytes;
+        return p;
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        if (contains(p)) return;   // Reclaimed with the whole arena
+        upstream_->deallocate(p, bytes, alignment);
+        overflowBytes_ -= bytes;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream_;
+    std::byte* base_ = nullptr;
+    size_t capacity_;
+    size_t used_ = 0;
+    ArenaBacking backing_ = ArenaBacking::Heap;
+    bool prefaulted_ = false;
+    bool numaBound_ = false;
+    size_t overflowBytes_ = 0;
+};
+
+class ArenaPool : public std::pmr::memory_resource {
+public:
+    explicit ArenaPool(size_t capacity,
+                       std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : arena_(capacity, upstream) {}
+
+    ArenaPool(const ArenaPool&) = delete;
+    ArenaPool& operator=(const ArenaPool&) = delete;
+
+    const ArenaResource& arena() const { return arena_; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        return pool_.allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        pool_.deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    ArenaResource arena_;
+    std::pmr::unsynchronized_pool_resource pool_{{0, 1 << 20}, &arena_};
+};
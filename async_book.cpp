@@ -0,0 +1,169 @@
+#include "async_book.hpp"
+#include <new>
+#include <thread>
+
+namespace {
+    constexpr size_t FRAME_GRANULE = 64;
+    constexpr size_t FRAME_CLASSES = 32;   // Frames up to 2 KB are pooled, larger ones go to the heap
+
+    struct FreeFrame { FreeFrame* next; };
+
+    struct ThreadFramePool {
+        FreeFrame* free[FRAME_CLASSES] = {};
+        FramePool::Stats stats;
+
+        ~ThreadFramePool() {
+            for (FreeFrame*& head : free) {
+                while (head) {
+                    FreeFrame* next = head->next;
+                    ::operator delete(head);
+                    head = next;
+                }
+            }
+        }
+    };
+
+    thread_local ThreadFramePool t_frames;
+
+    size_t frameClass(size_t bytes) { return (bytes + FRAME_GRANULE - 1) / FRAME_GRANULE - 1; }
+}
+
+void* FramePool::allocate(size_t bytes) {
+    size_t cls = frameClass(bytes);
+    if (cls < FRAME_CLASSES) {
+        if (FreeFrame* frame = t_frames.free[cls]) {
+            t_frames.free[cls] = frame->next;
+            ++t_frames.stats.reused;
+            return frame;
+        }
+        ++t_frames.stats.fresh;
+        return ::operator new((cls + 1) * FRAME_GRANULE);
+    }
+    ++t_frames.stats.fresh;
+    return ::operator new(bytes);
+}
+
+// A frame returns to the free list of the thread that finishes the coroutine
+void FramePool::deallocate(void* frame, size_t bytes) noexcept {
+    size_t cls = frameClass(bytes);
+    if (cls < FRAME_CLASSES) {
+        FreeFrame* node = static_cast<FreeFrame*>(frame);
+        node->next = t_frames.free[cls];
+        t_frames.free[cls] = node;
+        return;
+    }
+    ::operator delete(frame);
+}
+
+FramePool::Stats FramePool::threadStats() {
+    return t_frames.stats;
+}
+
+AsyncBook::AsyncBook(size_t maxOrders) : AsyncBook(maxOrders, Options{}) {}
+
+AsyncBook::AsyncBook(size_t maxOrders, const Options& options, std::pmr::memory_resource* upstream)
+    : options_(options), book_(maxOrders, upstream),
+      requests_(options.maxInFlight), completions_(options.maxInFlight) {
+    // Only the matching thread touches the book
+    book_.setConcurrencyMode(ConcurrencyMode::SingleThreaded);
+    scratchFills_.reserve(256);
+
+    EngineRunner::Options runner;
+    runner.cpu = options_.cpu;
+    runner.idle = options_.idle;
+    matcher_ = std::make_unique<EngineRunner>(runner, [this] { return poll(); },
+                                              [this] { return requests_.sizeApprox(); });
+}
+
+AsyncBook::~AsyncBook() {
+    stop();
+}
+
+void AsyncBook::stop() {
+    if (matcher_) matcher_->stop();
+}
+
+AsyncBook::Operation AsyncBook::submit(const Order& order, std::vector<Fill>* fills) {
+    return Operation(*this, Operation::Kind::Submit, order, fills);
+}
+
+AsyncBook::Operation AsyncBook::cancel(uint64_t orderId) {
+    Order order{};
+    order.id = orderId;
+    return Operation(*this, Operation::Kind::Cancel, order, nullptr);
+}
+
+AsyncBook::Operation AsyncBook::modify(uint64_t orderId, int64_t newPrice, uint32_t newQty, std::vector<Fill>* fills) {
+    Order order{};
+    order.id = orderId;
+    order.priceTick = newPrice;
+    order.quantity = newQty;
+    return Operation(*this, Operation::Kind::Modify, order, fills);
+}
+
+bool AsyncBook::Operation::await_suspend(std::coroutine_handle<> handle) noexcept {
+    AsyncBook& book = book_;
+    if (book.inFlight_.fetch_add(1, std::memory_order_acq_rel) >= book.options_.maxInFlight) {
+        book.inFlight_.fetch_sub(1, std::memory_order_acq_rel);
+        book.overloaded_.fetch_add(1, std::memory_order_relaxed);
+        result_.overloaded = true;
+        return false;   // Resume at once
+    }
+    handle_ = handle;
+    // Both queues hold maxInFlight entries, so this cannot fail. Once pushed, the
+    // operation may complete and its coroutine resume (on a draining thread) at any
+    // time: nothing here may touch *this afterwards.
+    while (!book.requests_.tryPush(this)) std::this_thread::yield();
+    return true;
+}
+
+size_t AsyncBook::poll() {
+    uint32_t batch = 0;
+    Operation* op;
+    while (batch < DRAIN_BATCH && requests_.tryPop(op)) {
+        apply(*op);
+        while (!completions_.tryPush(op)) std::this_thread::yield();
+        ++batch;
+    }
+    if (batch > 0) applied_.fetch_add(batch, std::memory_order_release);
+    return batch;
+}
+
+void AsyncBook::apply(Operation& op) {
+    std::vector<Fill>& fills = op.fills_ ? *op.fills_ : scratchFills_;
+    fills.clear();
+    AsyncResult& result = op.result_;
+    switch (op.kind_) {
+        case Operation::Kind::Submit:
+            result.accepted = book_.submitOrder(op.order_, &fills);
+            break;
+        case Operation::Kind::Cancel:
+            result.accepted = book_.cancelOrder(op.order_.id);
+            break;
+        case Operation::Kind::Modify:
+            result.accepted = book_.modifyOrder(op.order_.id, op.order_.priceTick, op.order_.quantity, &fills);
+            break;
+    }
+    result.fillCount = static_cast<uint32_t>(fills.size());
+    for (const Fill& fill : fills) result.filledQuantity += fill.quantity;
+}
+
+size_t AsyncBook::drain(size_t max) {
+    size_t resumed = 0;
+    Operation* op;
+    while (resumed < max && completions_.tryPop(op)) {
+        std::coroutine_handle<> handle = op->handle_;
+        inFlight_.fetch_sub(1, std::memory_order_acq_rel);
+        handle.resume();   // May finish the coroutine and free op
+        ++resumed;
+    }
+    return resumed;
+}
+
+AsyncBook::Stats AsyncBook::stats() const {
+    Stats stats;
+    stats.applied = applied_.load(std::memory_order_acquire);
+    stats.overloaded = overloaded_.load(std::memory_order_relaxed);
+    if (matcher_) stats.matcher = matcher_->stats();
+    return stats;
+}
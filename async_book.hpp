@@ -0,0 +1,144 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <vector>
+#include "order_book.hpp"
+#include "command_queue.hpp"
+#include "engine_runner.hpp"
+
+// Asynchronous facade over an OrderBook for C++20 coroutines.
+//
+//   AsyncTask trade(AsyncBook& book, Order order) {
+//       AsyncResult result = co_await book.submit(order, &fills);
+//       ...
+//   }
+//
+// The book is owned by a matching thread (an EngineRunner). co_await enqueues a
+// pointer to the awaiting operation, which lives in the coroutine's frame, and
+// suspends; the matching thread applies it and posts it to a completion queue.
+// The caller's event loop calls drain() to resume completed coroutines, so user
+// code never runs on the matching thread. Nothing is allocated per call: the
+// queues are preallocated and AsyncTask frames come from a per-thread pool.
+//
+// At most maxInFlight operations may be outstanding. Past that, co_await returns
+// at once with `overloaded` set instead of queueing without bound.
+
+// Per-thread free lists of coroutine frames, in 64-byte size classes
+class FramePool {
+public:
+    static void* allocate(size_t bytes);
+    static void deallocate(void* frame, size_t bytes) noexcept;
+
+    struct Stats {
+        uint64_t fresh = 0;     // Frames taken from the heap
+        uint64_t reused = 0;    // Frames served from a free list
+    };
+    static Stats threadStats();   // The calling thread's counters
+};
+
+// Fire-and-forget coroutine (starts eagerly, frees its frame when it finishes)
+struct AsyncTask {
+    struct promise_type {
+        AsyncTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+
+        static void* operator new(size_t bytes) { return FramePool::allocate(bytes); }
+        static void operator delete(void* frame, size_t bytes) noexcept { FramePool::deallocate(frame, bytes); }
+    };
+};
+
+struct AsyncResult {
+    bool     accepted = false;      // The book accepted the command
+    bool     overloaded = false;    // Not queued: too many operations in flight
+    uint32_t fillCount = 0;
+    uint64_t filledQuantity = 0;
+};
+
+class AsyncBook {
+public:
+    struct Options {
+        size_t maxInFlight = 1 << 14;
+        int cpu = -1;                // Matching thread's core
+        IdleOptions idle;
+    };
+
+    explicit AsyncBook(size_t maxOrders);
+    AsyncBook(size_t maxOrders, const Options& options,
+              std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+    ~AsyncBook();
+
+    AsyncBook(const AsyncBook&) = delete;
+    AsyncBook& operator=(const AsyncBook&) = delete;
+
+    // Awaitable for one command. Lives in the awaiting coroutine's frame.
+    class Operation {
+    public:
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle) noexcept;
+        AsyncResult await_resume() const noexcept { return result_; }
+
+    private:
+        friend class AsyncBook;
+        enum class Kind : uint8_t { Submit, Cancel, Modify };
+
+        Operation(AsyncBook& book, Kind kind, const Order& order, std::vector<Fill>* fills)
+            : book_(book), kind_(kind), order_(order), fills_(fills) {}
+
+        AsyncBook& book_;
+        Kind kind_;
+        Order order_;
+        std::vector<Fill>* fills_;
+        std::coroutine_handle<> handle_;
+        AsyncResult result_;
+    };
+
+    // Any thread. fills, if given, is cleared and receives the trades; it must stay
+    // valid until the coroutine resumes.
+    Operation submit(const Order& order, std::vector<Fill>* fills = nullptr);
+    Operation cancel(uint64_t orderId);
+    Operation modify(uint64_t orderId, int64_t newPrice, uint32_t newQty, std::vector<Fill>* fills = nullptr);
+
+    // Resumes up to `max` coroutines whose operations have completed, on the calling
+    // thread, and returns how many. Call from one thread at a time (the event loop).
+    size_t drain(size_t max = SIZE_MAX);
+
+    size_t inFlight() const { return inFlight_.load(std::memory_order_acquire); }
+
+    // Stops the matching thread once queued operations have been applied. Their
+    // coroutines still need a final drain().
+    void stop();
+
+    struct Stats {
+        uint64_t applied = 0;        // Operations the matching thread has completed
+        uint64_t overloaded = 0;
+        EngineRunner::Stats matcher;
+    };
+    Stats stats() const;
+
+    // Only read it while nothing is in flight
+    const OrderBook& book() const { return book_; }
+
+private:
+    size_t poll();
+    void apply(Operation& op);
+
+    static constexpr uint32_t DRAIN_BATCH = 64;
+
+    Options options_;
+    OrderBook book_;
+    CommandQueue<Operation*> requests_;
+    CommandQueue<Operation*> completions_;
+    std::vector<Fill> scratchFills_;
+    std::unique_ptr<EngineRunner> matcher_;
+
+    alignas(CACHE_LINE_BYTES) std::atomic<size_t> inFlight_{0};
+    std::atomic<uint64_t> overloaded_{0};
+    alignas(CACHE_LINE_BYTES) std::atomic<uint64_t> applied_{0};
+};
@@ -2,9 +2,22 @@
 // Verifies core order book operations
 
 #include "order_book.hpp"
+#include "book_manager.hpp"
+#include "sharded_engine.hpp"
+#include "book_events.hpp"
+#include "order_gateway.hpp"
+#include "async_book.hpp"
+#include "numa_placement.hpp"
 #include <iostream>
 #include <vector>
 #include <iomanip>
+#include <algorithm>
+
+// Rests an order, then crosses it; resumes after each ack
+AsyncTask cross_async(AsyncBook& book, std::vector<Fill>& fills, AsyncResult& rest, AsyncResult& take) {
+    rest = co_await book.submit({5001, Side::Sell, 100100, 30, OrderType::Limit, TimeInForce::GTC, 1, 0});
+    take = co_await book.submit({5002, Side::Buy, 100100, 20, OrderType::Limit, TimeInForce::GTC, 2, 0}, &fills);
+}
 
 int main() {
     std::cout << "=== BASIC ORDER BOOK FUNCTIONALITY TEST ===\n\n";
@@ -65,6 +78,242 @@ int main() {
     std::cout << "  Bid Levels: " << bid_levels.size() << "\n";
     std::cout << "  Ask Levels: " << ask_levels.size() << "\n\n";
 
+    // Test 8: Multi-instrument routing (cancel and amend by order ID alone)
+    std::cout << "Test 8: BookManager Routing\n";
+    BookManager books(10000);
+    books.submitOrder(7, {2001, Side::Buy, 100000, 10, OrderType::Limit, TimeInForce::GTC, 1, 0});
+    books.submitOrder(42, {2002, Side::Sell, 50000, 10, OrderType::Limit, TimeInForce::GTC, 2, 0});
+    bool amended = books.modifyOrder(2002, 50100, 5);
+    bool routed_cancel = books.cancelOrder(2001);
+    std::cout << "  Active Books: " << books.activeBooks() << " of " << books.maxInstruments() << "\n";
+    std::cout << "  Amend Routed: " << std::boolalpha << amended
+              << " (instrument " << books.instrumentOf(2002) << ")\n";
+    std::cout << "  Cancel Routed: " << routed_cancel << "\n";
+    std::cout << "  Resting Across Books: " << books.aggregateStats().restingOrders << "\n\n";
+
+    // Test 9: Sharded engine (instruments split across worker threads)
+    std::cout << "Test 9: Sharded Engine\n";
+    {
+        ShardedEngine::Options options;
+        options.workers = 2;
+        options.maxInstruments = 16;
+        ShardedEngine engine(options);
+        for (InstrumentId instrument = 0; instrument < 4; ++instrument) {
+            engine.submit(instrument, {3000 + instrument * 2, Side::Sell, 100100, 10, OrderType::Limit, TimeInForce::GTC, 1, 0});
+            engine.submit(instrument, {3001 + instrument * 2, Side::Buy, 100100, 4, OrderType::Limit, TimeInForce::GTC, 2, 0});
+        }
+        engine.waitIdle();
+        auto total = engine.totalStats();
+        std::cout << "  Workers: " << engine.workerCount() << "\n";
+        std::cout << "  Commands Processed: " << total.processed << "\n";
+        std::cout << "  Fills: " << total.fills << "\n\n";
+    }
+
+    // Test 10: Post-match event ring (drop copy consumes only journaled events)
+    std::cout << "Test 10: Event Ring\n";
+    {
+        OrderBook events_book(1000);
+        EventRing<BookEvent> events(64);
+        auto& journal = events.addConsumer();
+        auto& drop_copy = events.addConsumer({&journal});
+        events_book.setFillHandler(publishFillsTo(events, 5));
+        events_book.submitOrder({4001, Side::Sell, 100100, 10, OrderType::Limit, TimeInForce::GTC, 1, 0});
+        events_book.submitOrder({4002, Side::Sell, 100200, 10, OrderType::Limit, TimeInForce::GTC, 1, 0});
+        events_book.submitOrder({4003, Side::Buy, 100200, 15, OrderType::Limit, TimeInForce::GTC, 2, 0});
+        
+        size_t copied_before = drop_copy.poll([](const BookEvent&, uint64_t) {});
+        size_t journaled = journal.poll([](const BookEvent&, uint64_t) {});
+        uint32_t copied_qty = 0;
+        drop_copy.poll([&](const BookEvent& event, uint64_t) { copied_qty += event.fill.quantity; });
+        std::cout << "  Published: " << events.published() << "\n";
+        std::cout << "  Drop Copy Before Journal: " << copied_before << "\n";
+        std::cout << "  Journaled: " << journaled << ", Drop Copy Qty: " << copied_qty << "\n\n";
+    }
+
+    // Test 11: Staged gateway (validation off the matching thread)
+    std::cout << "Test 11: Order Gateway\n";
+    {
+        GatewayRules rules;
+        rules.maxInstruments = 4;
+        rules.instruments.assign(4, InstrumentRules{90000, 110000, 10, 1000});
+        OrderGateway gateway(rules, OrderGateway::Options{});
+        gateway.receive(7, "35=D|11=1|55=2|54=2|44=1001.00|38=50");
+        gateway.receive(9, "35=D|11=2|55=2|54=1|44=1001.00|38=20|59=3");
+        gateway.receive(9, "35=D|11=2|55=2|54=1|44=1001.00|38=20");      // Duplicate ID
+        gateway.receive(9, "35=D|11=3|55=2|54=1|44=1200.00|38=20");      // Outside the price band
+        gateway.receive(9, "35=D|11=4|55=2|54=1|44=1001.00|38=25");      // Not a whole lot
+        gateway.receive(8, "35=D|11=5|55=2|54=1|44=1001.00|38=10|1=7");  // Claims another owner
+        gateway.receive(8, "35=F|11=1|55=2");                             // Cancels another owner's order
+        gateway.waitIdle();
+        auto stats = gateway.stats();
+        std::cout << "  Forwarded: " << stats.forwarded << ", Rejected: " << stats.rejected() << "\n";
+        for (RejectReason reason : {RejectReason::DuplicateId, RejectReason::PriceBand, RejectReason::LotSize,
+                                    RejectReason::NotPermitted}) {
+            std::cout << "  " << rejectReasonName(reason) << ": " << stats.rejects[size_t(reason)] << "\n";
+        }
+        std::cout << "  Fills: " << stats.fills << ", Order 1 Resting: " << (gateway.books().instrumentOf(1) >= 0 ? "yes" : "no") << "\n\n";
+    }
+
+    // Test 12: Coroutine facade (co_await submit resumes once the matcher has applied it)
+    std::cout << "Test 12: Async Book\n";
+    {
+        AsyncBook async_book(1000);
+        std::vector<Fill> fills;
+        AsyncResult rest, take;
+        cross_async(async_book, fills, rest, take);
+        while (async_book.inFlight() > 0) async_book.drain();
+        std::cout << "  Rested: " << rest.accepted << ", Crossed: " << take.accepted << "\n";
+        std::cout << "  Fills: " << take.fillCount << ", Filled Qty: " << take.filledQuantity
+                  << ", Maker: " << (fills.empty() ? 0 : fills[0].makerOrderId) << "\n\n";
+    }
+
+    // Test 13: Cancel lane (cancels overtake queued orders but never their own submit)
+    std::cout << "Test 13: Cancel Lane\n";
+    {
+        ShardedEngine::Options options;
+        options.workers = 1;
+        options.pinThreads = false;
+        options.cancelLane = true;
+        options.cancelBurst = 2;
+        ShardedEngine engine(options);
+        for (uint64_t id = 6001; id <= 6010; ++id) {
+            engine.submit(0, {id, Side::Buy, 99900, 10, OrderType::Limit, TimeInForce::GTC, 1, 0});
+        }
+        engine.cancel(0, 6003);
+        engine.cancel(0, 6010);
+        engine.amendDown(0, 6005, 99900, 4);
+        engine.cancel(0, 6999);                       // Unknown: held, then rejected
+        engine.waitIdle();
+        auto stats = engine.totalStats();
+        std::cout << "  Cancel Lane: " << stats.cancelLane << ", Rejected: " << stats.rejected << "\n";
+        std::cout << "  Resting: " << engine.shard(0).book(0)->memoryUsage().restingOrders
+                  << ", Bid Volume: " << engine.shard(0).book(0)->getTotalVolume(Side::Buy) << "\n\n";
+    }
+
+    // Test 14: Amend coalescing (one worker batch: three amends and a cancel become one cancel)
+    std::cout << "Test 14: Amend Coalescing\n";
+    {
+        CommandCoalescer coalescer;
+        EngineCommand batch[6] = {
+            {CommandType::Modify, 0, {7001, Side::Buy, 99900, 8, OrderType::Limit, TimeInForce::GTC, 1, 0}},
+            {CommandType::Modify, 0, {7002, Side::Buy, 99800, 5, OrderType::Limit, TimeInForce::GTC, 1, 0}},
+            {CommandType::Modify, 0, {7001, Side::Buy, 99900, 6, OrderType::Limit, TimeInForce::GTC, 1, 0}},
+            {CommandType::Modify, 0, {7001, Side::Buy, 99900, 4, OrderType::Limit, TimeInForce::GTC, 1, 0}},
+            {CommandType::Cancel, 0, {7001, Side::Buy, 0, 0, OrderType::Limit, TimeInForce::GTC, 1, 0}},
+            {CommandType::Modify, 0, {7002, Side::Buy, 99800, 3, OrderType::Limit, TimeInForce::GTC, 1, 0}},
+        };
+        bool skip[6];
+        size_t collapsed = coalescer.coalesce(batch, 6, skip);
+        std::cout << "  Collapsed: " << collapsed << ", Applied:";
+        for (size_t i = 0; i < 6; ++i) {
+            if (!skip[i]) std::cout << " " << (batch[i].type == CommandType::Cancel ? "cancel " : "amend ") << batch[i].order.id;
+        }
+        std::cout << "\n\n";
+    }
+
+    // Test 15: Admission control (a rate-limited owner is refused at receive; cancels are exempt)
+    std::cout << "Test 15: Admission Control\n";
+    {
+        GatewayRules rules;
+        rules.maxInstruments = 4;
+        rules.instruments.assign(4, InstrumentRules{90000, 110000, 10, 1000});
+        rules.ownerLimits.resize(8);
+        rules.ownerLimits[5].rate = {1, 2};    // One message a second, bursts of two
+        OrderGateway gateway(rules, OrderGateway::Options{});
+        RejectReason refused = RejectReason::None;
+        gateway.receive(5, "35=D|11=1|55=1|54=1|44=1000.00|38=10");
+        gateway.receive(5, "35=D|11=2|55=1|54=1|44=1000.00|38=10");
+        bool third = gateway.receive(5, "35=D|11=3|55=1|54=1|44=1000.00|38=10", &refused);
+        bool cancel = gateway.receive(5, "35=F|11=1|55=1");
+        // A second tag 35 may not pass a new order off as a cancel
+        RejectReason disguised = RejectReason::None;
+        gateway.receive(5, "35=F|11=4|55=1|35=D|54=1|44=1000.00|38=10", &disguised);
+        gateway.receive(6, "35=F|11=4|55=1|35=D|54=1|44=1000.00|38=10");   // Unlimited: reaches validation
+        gateway.waitIdle();
+        auto stats = gateway.stats();
+        std::cout << "  Third order: " << (third ? "accepted" : rejectReasonName(refused))
+                  << ", Cancel: " << (cancel ? "accepted" : "refused") << "\n";
+        std::cout << "  Forwarded: " << stats.forwarded << ", Rate Limited: "
+                  << stats.rejects[size_t(RejectReason::RateLimited)] << "\n";
+        std::cout << "  Repeated Tag 35: " << rejectReasonName(disguised) << ", then "
+                  << rejectReasonName(RejectReason::Malformed) << ": "
+                  << stats.rejects[size_t(RejectReason::Malformed)] << "\n\n";
+    }
+
+    // Test 16: Mass cancel by owner (filled orders have already left the owner's list)
+    std::cout << "Test 16: Mass Cancel\n";
+    {
+        OrderBook kill_book(1000);
+        kill_book.submitOrder({8001, Side::Buy, 10000, 10, OrderType::Limit, TimeInForce::GTC, 2, 0});
+        kill_book.submitOrder({8002, Side::Buy, 9900, 10, OrderType::Limit, TimeInForce::GTC, 2, 0});
+        kill_book.submitOrder({8003, Side::Buy, 9800, 10, OrderType::Limit, TimeInForce::GTC, 2, 0});
+        kill_book.submitOrder({8004, Side::Sell, 10500, 5, OrderType::Limit, TimeInForce::GTC, 2, 0});
+        kill_book.submitOrder({8005, Side::Buy, 9900, 10, OrderType::Limit, TimeInForce::GTC, 1, 0});
+        kill_book.submitOrder({8006, Side::Sell, 10000, 10, OrderType::Limit, TimeInForce::IOC, 3, 0});
+        EventRing<BookEvent> events(16);
+        auto& drop_copy = events.addConsumer();
+        std::vector<uint64_t> bid_ids;
+        auto bids = kill_book.cancelOwner(2, Side::Buy, &bid_ids);
+        publishMassCancel(events, 0, 2, bids, bid_ids);
+        std::vector<uint64_t> ids;
+        auto rest = kill_book.cancelOwner(2, &ids);
+        std::cout << "  Buy Side: " << bids.orders << " orders, " << bids.quantity << " qty; Then: "
+                  << rest.orders << " (" << (ids.empty() ? 0 : ids[0]) << ")\n";
+        std::cout << "  Drop Copy:";
+        drop_copy.poll([](const BookEvent& event, uint64_t) {
+            if (event.type == BookEventType::MassCancelled) {
+                std::cout << " owner " << event.massCancel.owner << " pulled " << event.massCancel.orders
+                          << " (" << event.massCancel.quantity << " qty):";
+            } else {
+                std::cout << " " << event.orderId;
+            }
+        });
+        std::cout << "\n";
+        std::cout << "  Resting: " << kill_book.memoryUsage().restingOrders
+                  << ", Best Bid: $" << std::fixed << std::setprecision(2) << kill_book.bestBid() << "\n\n";
+    }
+
+    // Test 17: Warmup leaves counters and lock statistics as they were before the open
+    std::cout << "Test 17: Warmup\n";
+    {
+        OrderBook warm_book(1000);
+        warm_book.setLockStatsEnabled(true);
+        warm_book.warmup(50);
+        const auto& warm_stats = warm_book.getStats();
+        std::cout << "  Processed: " << warm_stats.getOrdersProcessed()
+                  << ", Submit Lock Samples: " << warm_stats.getLockStats(LockSite::Submit).hold.getCount()
+                  << ", Resting: " << warm_book.memoryUsage().restingOrders << "\n";
+        warm_book.submitOrder({9001, Side::Buy, 10000, 10, OrderType::Limit, TimeInForce::GTC, 1, 0});
+        std::cout << "  After One Submit: " << warm_stats.getLockStats(LockSite::Submit).hold.getCount()
+                  << " lock sample\n\n";
+    }
+
+    // Test 18: Worker placement (only CPUs the process may use; a refused pin is reported)
+    std::cout << "Test 18: Worker Pinning\n";
+    {
+        std::vector<int> allowed = HFTNuma::allowedCpus();
+        ShardedEngine::Options placed;
+        placed.workers = 2;
+        placed.maxInstruments = 4;
+        placed.queueCapacity = 64;
+        ShardedEngine engine(placed);
+        bool inMask = true;
+        for (unsigned w = 0; w < engine.workerCount(); ++w) {
+            int cpu = engine.workerStats(w).cpu;
+            inMask = inMask && std::find(allowed.begin(), allowed.end(), cpu) != allowed.end();
+        }
+        engine.stop();
+
+        ShardedEngine::Options refused = placed;
+        refused.cpus = {1 << 20};   // Beyond any CPU set
+        ShardedEngine bad(refused);
+        bad.submit(0, {9101, Side::Buy, 10000, 10, OrderType::Limit, TimeInForce::GTC, 1, 0});
+        bad.stop();   // Joins the workers, so both have tried to pin
+        std::cout << "  Default CPUs In Affinity Mask: " << (inMask ? "yes" : "no")
+                  << ", Refused Pins Reported: " << bad.totalStats().pinFailures
+                  << ", Still Applied: " << bad.totalStats().processed << "\n\n";
+    }
+
     // Final stats
     std::cout << "=== FINAL ORDER BOOK STATE ===\n";
     std::cout << "Best Bid: $" << std::fixed << std::setprecision(2) << ob.bestBid() << "\n";
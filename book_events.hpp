@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "order_book.hpp"
+#include "book_manager.hpp"
+#include "event_ring.hpp"
+
+// Book events for post-match processing (journal, market data, drop copy, risk).
+//
+// Rather than doing that work in the fill handler, under the book mutex, the
+// matching thread publishes each event to an EventRing and downstream consumers
+// run on their own threads:
+//
+//   EventRing<BookEvent> events(1 << 16);
+//   auto& journal  = events.addConsumer();
+//   auto& dropCopy = events.addConsumer({&journal});   // Only sees journaled events
+//   auto& marketData = events.addConsumer();
+//   book.setFillHandler(publishFillsTo(events));
+//
+// The ring has a single producer, so one ring per matching thread (e.g. per
+// ShardedEngine worker).
+
+enum class BookEventType : uint8_t { Accepted, Rejected, Cancelled, Modified, Fill, MassCancelled };
+
+// Header of a kill switch; a Cancelled event for each order pulled follows it
+struct MassCancelSummary {
+    uint32_t owner;
+    uint32_t orders;      // Cancelled events that follow
+    uint64_t quantity;    // Open quantity pulled
+};
+
+struct BookEvent {
+    BookEventType type = BookEventType::Fill;
+    InstrumentId  instrument = 0;
+    uint64_t      orderId = 0;    // Order the command targeted (the taker for fills, 0 for mass cancels)
+    union {
+        Fill              fill{};       // Fill events
+        MassCancelSummary massCancel;   // MassCancelled events
+    };
+};
+
+// Fill handler that publishes every fill (waiting if the ring is full)
+inline OrderBook::FillHandler publishFillsTo(EventRing<BookEvent>& ring, InstrumentId instrument = 0) {
+    return [&ring, instrument](const Fill& fill) {
+        ring.publish({BookEventType::Fill, instrument, fill.takerOrderId, fill});
+    };
+}
+
+// Outcome of a command, published by the matching thread after it returns
+inline void publishOrderEvent(EventRing<BookEvent>& ring, BookEventType type, InstrumentId instrument,
+                              uint64_t orderId) {
+    ring.publish({type, instrument, orderId, Fill{}});
+}
+
+// A kill switch: one MassCancelled header with the totals, then a Cancelled event
+// for each ID that cancelOwner() reported
+inline void publishMassCancel(EventRing<BookEvent>& ring, InstrumentId instrument, uint32_t ownerId,
+                              const OrderBook::MassCancel& result, const std::vector<uint64_t>& cancelled) {
+    BookEvent header;
+    header.type = BookEventType::MassCancelled;
+    header.instrument = instrument;
+    header.massCancel = {ownerId, static_cast<uint32_t>(cancelled.size()), result.quantity};
+    ring.publish(header);
+    for (uint64_t id : cancelled) publishOrderEvent(ring, BookEventType::Cancelled, instrument, id);
+}
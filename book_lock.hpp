@@ -0,0 +1,269 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <type_traits>
+#include <variant>
+
+#if defined(__GLIBC__)
+#include <pthread.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// The order book's mutex and the lock backends it can run on.
+//
+// Exclusive mode (the default) is a plain std::mutex: every call, query or order,
+// serialises, and waiters sleep in the kernel. The other modes trade that off:
+//
+//   TicketSpin      FIFO ticket lock; waiters spin with pause, backing off in
+//                   proportion to their place in line. No kernel wakeup latency,
+//                   but burns the waiting cores. For pinned, uncontended-core setups.
+//   AdaptiveSpin    Spins briefly (most critical sections are shorter than a
+//                   wakeup), then sleeps on a futex.
+//   SharedReaders   Reader-writer lock: read-only queries run concurrently and only
+//                   exclude writers. Writers are preferred, so a flood of queries
+//                   cannot starve matching.
+//   SingleThreaded  No locking at all, for a book owned by one thread (e.g. a
+//                   ShardedEngine worker). Any concurrent call is a data race.
+//
+// Each backend is also usable on its own as a Lockable type.
+
+namespace HFTLocks {
+    inline void pause() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+}
+
+// FIFO ticket spinlock with proportional backoff
+class TicketSpinLock {
+public:
+    TicketSpinLock() = default;
+    TicketSpinLock(const TicketSpinLock&) = delete;
+    TicketSpinLock& operator=(const TicketSpinLock&) = delete;
+
+    void lock() {
+        const uint32_t ticket = next_.fetch_add(1, std::memory_order_relaxed);
+        uint32_t spins = 0;
+        for (;;) {
+            const uint32_t serving = serving_.load(std::memory_order_acquire);
+            if (serving == ticket) return;
+            // Waiters further back poll less often, keeping the line quiet for the holder
+            for (uint32_t i = std::min(ticket - serving, MAX_BACKOFF_WAITERS) * PAUSES_PER_WAITER; i > 0; --i) {
+                HFTLocks::pause();
+            }
+            // The holder (or the next in line) may be descheduled on an oversubscribed core; let it run
+            if (++spins >= YIELD_AFTER) std::this_thread::yield();
+        }
+    }
+
+    bool try_lock() {
+        uint32_t serving = serving_.load(std::memory_order_relaxed);
+        uint32_t expected = serving;
+        return next_.compare_exchange_strong(expected, serving + 1, std::memory_order_acquire,
+                                             std::memory_order_relaxed);
+    }
+
+    void unlock() {
+        serving_.store(serving_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    static constexpr uint32_t PAUSES_PER_WAITER = 16;
+    static constexpr uint32_t MAX_BACKOFF_WAITERS = 8;
+    static constexpr uint32_t YIELD_AFTER = 64;       // Polls before each further poll also yields
+
+    std::atomic<uint32_t> next_{0};
+    std::atomic<uint32_t> serving_{0};
+};
+
+// Spin-then-sleep mutex: 0 = free, 1 = held, 2 = held with (possible) sleepers
+class AdaptiveMutex {
+public:
+    AdaptiveMutex() = default;
+    AdaptiveMutex(const AdaptiveMutex&) = delete;
+    AdaptiveMutex& operator=(const AdaptiveMutex&) = delete;
+
+    void lock() {
+        for (uint32_t i = 0; i < SPIN_LIMIT; ++i) {
+            uint32_t expected = 0;
+            if (state_.load(std::memory_order_relaxed) == 0 &&
+                state_.compare_exchange_weak(expected, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return;
+            }
+            HFTLocks::pause();
+        }
+        // Slow path: mark the lock contended and sleep until the holder wakes us
+        uint32_t previous = state_.exchange(2, std::memory_order_acquire);
+        while (previous != 0) {
+            wait();
+            previous = state_.exchange(2, std::memory_order_acquire);
+        }
+    }
+
+    bool try_lock() {
+        uint32_t expected = 0;
+        return state_.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock() {
+        if (state_.exchange(0, std::memory_order_release) == 2) wake();
+    }
+
+private:
+    static constexpr uint32_t SPIN_LIMIT = 128;
+
+    void wait() {
+#if defined(__linux__) && defined(SYS_futex)
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state_), FUTEX_WAIT_PRIVATE, 2u, nullptr, nullptr, 0);
+#else
+        state_.wait(2, std::memory_order_relaxed);
+#endif
+    }
+
+    void wake() {
+#if defined(__linux__) && defined(SYS_futex)
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&state_), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+        state_.notify_one();
+#endif
+    }
+
+    std::atomic<uint32_t> state_{0};
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit int");
+};
+
+// Writer-preferring reader-writer lock. glibc's default rwlock (and so
+// std::shared_mutex) prefers readers; ask for the writer-preferring kind there.
+class SharedBookMutex {
+public:
+#if defined(__GLIBC__)
+    SharedBookMutex() {
+        pthread_rwlockattr_t attr;
+        pthread_rwlockattr_init(&attr);
+        pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+        pthread_rwlock_init(&lock_, &attr);
+        pthread_rwlockattr_destroy(&attr);
+    }
+    ~SharedBookMutex() { pthread_rwlock_destroy(&lock_); }
+
+    void lock()          { pthread_rwlock_wrlock(&lock_); }
+    void unlock()        { pthread_rwlock_unlock(&lock_); }
+    void lock_shared()   { pthread_rwlock_rdlock(&lock_); }
+    void unlock_shared() { pthread_rwlock_unlock(&lock_); }
+#else
+    SharedBookMutex() = default;
+    void lock()          { lock_.lock(); }
+    void unlock()        { lock_.unlock(); }
+    void lock_shared()   { lock_.lock_shared(); }
+    void unlock_shared() { lock_.unlock_shared(); }
+#endif
+
+    SharedBookMutex(const SharedBookMutex&) = delete;
+    SharedBookMutex& operator=(const SharedBookMutex&) = delete;
+
+private:
+#if defined(__GLIBC__)
+    pthread_rwlock_t lock_;
+#else
+    std::shared_mutex lock_;
+#endif
+};
+
+// For books owned by a single thread
+class NullLock {
+public:
+    void lock() {}
+    bool try_lock() { return true; }
+    void unlock() {}
+};
+
+enum class ConcurrencyMode : uint8_t {   // Order matches BookMutex's variant
+    Exclusive,       // std::mutex
+    TicketSpin,      // TicketSpinLock
+    AdaptiveSpin,    // AdaptiveMutex
+    SharedReaders,   // Concurrent queries, exclusive writers (SharedBookMutex)
+    SingleThreaded   // NullLock
+};
+
+inline const char* concurrencyModeName(ConcurrencyMode mode) {
+    switch (mode) {
+        case ConcurrencyMode::TicketSpin:     return "ticket spin";
+        case ConcurrencyMode::AdaptiveSpin:   return "adaptive spin";
+        case ConcurrencyMode::SharedReaders:  return "shared readers";
+        case ConcurrencyMode::SingleThreaded: return "single-threaded";
+        default:                              return "exclusive";
+    }
+}
+
+// Holds only the backend the mode selects, so the others cost no memory. The mode
+// is the variant's index; each call dispatches on it with a single switch.
+class BookMutex {
+public:
+    BookMutex() = default;
+    BookMutex(const BookMutex&) = delete;
+    BookMutex& operator=(const BookMutex&) = delete;
+
+    ConcurrencyMode mode() const { return static_cast<ConcurrencyMode>(lock_.index()); }
+
+    // Only while no thread holds or is waiting for the lock
+    void setMode(ConcurrencyMode mode) {
+        if (mode == this->mode()) return;
+        switch (mode) {
+            case ConcurrencyMode::Exclusive:      lock_.emplace<std::mutex>(); break;
+            case ConcurrencyMode::TicketSpin:     lock_.emplace<TicketSpinLock>(); break;
+            case ConcurrencyMode::AdaptiveSpin:   lock_.emplace<AdaptiveMutex>(); break;
+            case ConcurrencyMode::SharedReaders:  lock_.emplace<SharedBookMutex>(); break;
+            case ConcurrencyMode::SingleThreaded: lock_.emplace<NullLock>(); break;
+        }
+    }
+
+    void lock() {
+        switch (mode()) {
+            case ConcurrencyMode::Exclusive:      std::get<std::mutex>(lock_).lock(); break;
+            case ConcurrencyMode::TicketSpin:     std::get<TicketSpinLock>(lock_).lock(); break;
+            case ConcurrencyMode::AdaptiveSpin:   std::get<AdaptiveMutex>(lock_).lock(); break;
+            case ConcurrencyMode::SharedReaders:  std::get<SharedBookMutex>(lock_).lock(); break;
+            case ConcurrencyMode::SingleThreaded: break;
+        }
+    }
+    void unlock() {
+        switch (mode()) {
+            case ConcurrencyMode::Exclusive:      std::get<std::mutex>(lock_).unlock(); break;
+            case ConcurrencyMode::TicketSpin:     std::get<TicketSpinLock>(lock_).unlock(); break;
+            case ConcurrencyMode::AdaptiveSpin:   std::get<AdaptiveMutex>(lock_).unlock(); break;
+            case ConcurrencyMode::SharedReaders:  std::get<SharedBookMutex>(lock_).unlock(); break;
+            case ConcurrencyMode::SingleThreaded: break;
+        }
+    }
+
+    // Readers; only SharedReaders mode lets them overlap
+    void lock_shared() {
+        if (mode() == ConcurrencyMode::SharedReaders) std::get<SharedBookMutex>(lock_).lock_shared();
+        else lock();
+    }
+    void unlock_shared() {
+        if (mode() == ConcurrencyMode::SharedReaders) std::get<SharedBookMutex>(lock_).unlock_shared();
+        else unlock();
+    }
+
+private:
+    // Alternatives in ConcurrencyMode order
+    using Backends = std::variant<std::mutex, TicketSpinLock, AdaptiveMutex, SharedBookMutex, NullLock>;
+    static_assert(std::is_same_v<std::variant_alternative_t<size_t(ConcurrencyMode::SharedReaders), Backends>,
+                                 SharedBookMutex>);
+    static_assert(std::is_same_v<std::variant_alternative_t<size_t(ConcurrencyMode::SingleThreaded), Backends>,
+                                 NullLock>);
+    Backends lock_;
+};
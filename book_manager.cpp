@@ -0,0 +1,169 @@
+#include "book_manager.hpp"
+
+BookManager::BookManager(size_t maxInstruments, size_t ordersPerBookHint,
+                         std::pmr::memory_resource* upstream)
+    : upstream_(upstream),
+      ordersPerBookHint_(ordersPerBookHint),
+      books_(maxInstruments, upstream),
+      indexBytes_(upstream) {}
+
+OrderBook& BookManager::bookFor(InstrumentId instrument) {
+    std::unique_ptr<OrderBook>& slot = books_[instrument];
+    if (!slot) {
+        slot = std::make_unique<OrderBook>(ordersPerBookHint_, upstream_);
+        slot->setConcurrencyMode(bookMode_);
+        if (fillCb_) {
+            slot->setFillHandler([this, instrument](const Fill& fill) { fillCb_(instrument, fill); });
+        }
+        ++activeBooks_;
+    }
+    return *slot;
+}
+
+// Makers leave the index once their open quantity is used up
+void BookManager::applyFills(const Fill* begin, const Fill* end) {
+    for (const Fill* fill = begin; fill != end; ++fill) {
+        auto it = index_.find(fill->makerOrderId);
+        if (it == index_.end()) continue;
+        it->second.openQty -= fill->quantity;
+        if (it->second.openQty == 0) index_.erase(it);
+    }
+}
+
+// Indexes the part of an accepted order that came to rest (same rule as OrderBook::submitOrder)
+void BookManager::indexTaker(InstrumentId instrument, const Order& order,
+                             const Fill* begin, const Fill* end) {
+    if (order.tif == TimeInForce::IOC || order.tif == TimeInForce::FOK) return;
+    uint32_t remaining = order.quantity;
+    for (const Fill* fill = begin; fill != end; ++fill) {
+        if (fill->takerOrderId == order.id) remaining -= fill->quantity;
+    }
+    if (remaining > 0) index_.emplace(order.id, IndexEntry{instrument, remaining, order.ownerId});
+}
+
+bool BookManager::submitOrder(InstrumentId instrument, const Order& order, std::vector<Fill>* fills) {
+    if (instrument >= books_.size() || index_.count(order.id) != 0) return false;
+
+    std::vector<Fill>& out = fills ? *fills : scratchFills_;
+    if (!fills) scratchFills_.clear();
+    size_t first = out.size();
+
+    if (!bookFor(instrument).submitOrder(order, &out)) return false;
+
+    const Fill* begin = out.data() + first;
+    const Fill* end = out.data() + out.size();
+    applyFills(begin, end);
+    indexTaker(instrument, order, begin, end);
+    return true;
+}
+
+bool BookManager::cancelOrder(uint64_t orderId) {
+    auto it = index_.find(orderId);
+    if (it == index_.end()) return false;
+    InstrumentId instrument = it->second.instrument;
+    index_.erase(it);
+    return books_[instrument]->cancelOrder(orderId);
+}
+
+OrderBook::MassCancel BookManager::cancelOwner(uint32_t ownerId) {
+    OrderBook::MassCancel total;
+    for (auto& book : books_) {
+        if (!book) continue;
+        scratchIds_.clear();
+        OrderBook::MassCancel result = book->cancelOwner(ownerId, &scratchIds_);
+        for (uint64_t id : scratchIds_) index_.erase(id);
+        total.orders += result.orders;
+        total.quantity += result.quantity;
+    }
+    return total;
+}
+
+bool BookManager::modifyOrder(uint64_t orderId, int64_t newPrice, uint32_t newQty, std::vector<Fill>* fills) {
+    auto it = index_.find(orderId);
+    if (it == index_.end()) return false;
+    InstrumentId instrument = it->second.instrument;
+    uint32_t owner = it->second.owner;
+    index_.erase(it);
+
+    OrderBook& book = *books_[instrument];
+    std::vector<Fill>& out = fills ? *fills : scratchFills_;
+    if (!fills) scratchFills_.clear();
+    size_t first = out.size();
+
+    if (!book.modifyOrder(orderId, newPrice, newQty, &out)) return false;
+
+    // The amended order keeps its side, type, time in force and owner
+    Order amended{};
+    amended.id = orderId;
+    amended.quantity = newQty;
+    amended.tif = TimeInForce::GTC;
+    amended.ownerId = owner;
+    const Fill* begin = out.data() + first;
+    const Fill* end = out.data() + out.size();
+    applyFills(begin, end);
+    indexTaker(instrument, amended, begin, end);
+    return true;
+}
+
+int64_t BookManager::instrumentOf(uint64_t orderId) const {
+    auto it = index_.find(orderId);
+    return it == index_.end() ? -1 : int64_t(it->second.instrument);
+}
+
+int64_t BookManager::ownerOf(uint64_t orderId) const {
+    auto it = index_.find(orderId);
+    return it == index_.end() ? -1 : int64_t(it->second.owner);
+}
+
+void BookManager::setFillHandler(FillHandler handler) {
+    fillCb_ = std::move(handler);
+    for (size_t i = 0; i < books_.size(); ++i) {
+        if (!books_[i]) continue;
+        if (fillCb_) {
+            InstrumentId instrument = static_cast<InstrumentId>(i);
+            books_[i]->setFillHandler([this, instrument](const Fill& fill) { fillCb_(instrument, fill); });
+        } else {
+            books_[i]->setFillHandler(nullptr);
+        }
+    }
+}
+
+void BookManager::setBookConcurrencyMode(ConcurrencyMode mode) {
+    bookMode_ = mode;
+    for (auto& book : books_) {
+        if (book) book->setConcurrencyMode(mode);
+    }
+}
+
+size_t BookManager::releaseEmptyBooks() {
+    size_t released = 0;
+    for (auto& slot : books_) {
+        // getOrderCount() counts placements minus cancels, so ask for the resting count
+        if (slot && slot->memoryUsage().restingOrders == 0) {
+            slot.reset();
+            ++released;
+        }
+    }
+    activeBooks_ -= released;
+    return released;
+}
+
+BookManager::AggregateStats BookManager::aggregateStats() const {
+    AggregateStats stats;
+    for (const auto& slot : books_) {
+        if (!slot) continue;
+        ++stats.activeBooks;
+        stats.ordersProcessed += slot->getStats().getOrdersProcessed();
+        stats.fillsGenerated += slot->getStats().getFillsGenerated();
+
+        OrderBook::MemoryUsage usage = slot->memoryUsage();
+        stats.restingOrders += usage.restingOrders;
+        stats.bookMemory.orderBytes += usage.orderBytes;
+        stats.bookMemory.levelBytes += usage.levelBytes;
+        stats.bookMemory.indexBytes += usage.indexBytes;
+        stats.bookMemory.bufferBytes += usage.bufferBytes;
+    }
+    stats.bookMemory.restingOrders = stats.restingOrders;
+    stats.routingBytes = sizeof(BookManager) + books_.capacity() * sizeof(books_[0]) + indexBytes_.bytesInUse();
+    return stats;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <functional>
+#include <unordered_map>
+#include "order_book.hpp"
+#include "memory_accounting.hpp"
+
+// Owns one OrderBook per instrument, keyed by a dense instrument ID (0..maxInstruments-1).
+//
+// Books are created on the first order for an instrument, so an instrument that never
+// trades costs one pointer. New books are sized for few orders (small order chunks,
+// no pre-reserved index, lock statistics off), so an idle book is a few KB and grows
+// only as orders rest on it.
+//
+// Cancels and amends carry only the order ID: a global order ID -> instrument index
+// (one hash lookup) routes them to the right book. Order IDs are therefore unique
+// across all instruments. The index is kept exact by tracking each resting order's
+// open quantity from the fills it takes part in.
+//
+// Commands (submit/cancel/modify/cancelOwner/releaseEmptyBooks) must come from one thread at a
+// time; give each engine thread its own manager. Market data queries on the books
+// returned by book() are safe from any thread, unless the books run SingleThreaded.
+
+using InstrumentId = uint32_t;
+
+class BookManager {
+public:
+    explicit BookManager(size_t maxInstruments,
+                         size_t ordersPerBookHint = 0,
+                         std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+    BookManager(const BookManager&) = delete;
+    BookManager& operator=(const BookManager&) = delete;
+
+    // Routed commands. Unknown instruments, unknown order IDs and order IDs already
+    // resting on any instrument are rejected.
+    bool submitOrder(InstrumentId instrument, const Order& order, std::vector<Fill>* fills = nullptr);
+    bool cancelOrder(uint64_t orderId);
+    bool modifyOrder(uint64_t orderId, int64_t newPrice, uint32_t newQty, std::vector<Fill>* fills = nullptr);
+    // Kill switch across every instrument: cancels all of an owner's resting orders
+    OrderBook::MassCancel cancelOwner(uint32_t ownerId);
+
+    // Instrument an order is resting on, or -1
+    int64_t instrumentOf(uint64_t orderId) const;
+    // Owner of a resting order, or -1
+    int64_t ownerOf(uint64_t orderId) const;
+
+    // Book for an instrument, or nullptr if it has not traded yet
+    const OrderBook* book(InstrumentId instrument) const {
+        return instrument < books_.size() ? books_[instrument].get() : nullptr;
+    }
+
+    size_t maxInstruments() const { return books_.size(); }
+    size_t activeBooks() const { return activeBooks_; }
+
+    // Lock backend for every book, existing and future. SingleThreaded suits a manager
+    // owned by one engine thread, but then book() queries are only safe from that thread
+    // (or while it is idle).
+    void setBookConcurrencyMode(ConcurrencyMode mode);
+    ConcurrencyMode bookConcurrencyMode() const { return bookMode_; }
+
+    // Fills from every book, tagged with the instrument they happened on
+    using FillHandler = std::function<void(InstrumentId, const Fill&)>;
+    void setFillHandler(FillHandler handler);
+
+    // Destroys books with nothing resting, returning their memory (end of session,
+    // or after a burst of new listings). Pointers from book() for those become invalid.
+    size_t releaseEmptyBooks();
+
+    struct AggregateStats {
+        size_t   activeBooks = 0;
+        uint64_t restingOrders = 0;
+        uint64_t ordersProcessed = 0;
+        uint64_t fillsGenerated = 0;
+        OrderBook::MemoryUsage bookMemory;   // Summed over active books
+        size_t   routingBytes = 0;           // Book table and order ID index
+
+        size_t totalBytes() const { return bookMemory.totalBytes() + routingBytes; }
+    };
+    AggregateStats aggregateStats() const;
+
+private:
+    // Open quantity is tracked so fully filled makers leave the index without a book lookup
+    struct IndexEntry {
+        InstrumentId instrument;
+        uint32_t     openQty;
+        uint32_t     owner;
+    };
+    using OrderIndex = std::pmr::unordered_map<uint64_t, IndexEntry>;
+
+    OrderBook& bookFor(InstrumentId instrument);
+    void applyFills(const Fill* begin, const Fill* end);
+    void indexTaker(InstrumentId instrument, const Order& order, const Fill* begin, const Fill* end);
+
+    std::pmr::memory_resource* upstream_;
+    size_t ordersPerBookHint_;
+    size_t activeBooks_ = 0;
+    ConcurrencyMode bookMode_ = ConcurrencyMode::Exclusive;
+
+    std::pmr::vector<std::unique_ptr<OrderBook>> books_;
+
+    CountingResource indexBytes_;
+    std::pmr::unsynchronized_pool_resource indexPool_{&indexBytes_};
+    OrderIndex index_{&indexPool_};
+
+    std::vector<Fill> scratchFills_;   // Used when the caller doesn't collect fills
+    std::vector<uint64_t> scratchIds_;
+    FillHandler fillCb_;
+};
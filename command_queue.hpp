@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+// Bounded lock-free queue for handing commands to an engine thread.
+//
+// Any number of producers may push concurrently; one consumer pops. Each slot
+// carries a sequence number that tells producers and the consumer whose turn it
+// is, so a push is one CAS on the tail plus a release store on the slot, and a
+// pop is a plain load/store on the head (Vyukov's bounded queue, single-consumer
+// side). Capacity is rounded up to a power of two. A full queue rejects the push
+// rather than blocking; the caller decides whether to retry or drop.
+
+inline constexpr size_t CACHE_LINE_BYTES = 64;
+
+template<typename T>
+class CommandQueue {
+    static_assert(std::is_trivially_copyable_v<T>, "Commands are copied in and out of slots");
+
+public:
+    explicit CommandQueue(size_t capacity) {
+        capacity_ = 2;
+        while (capacity_ < capacity) capacity_ <<= 1;
+        mask_ = capacity_ - 1;
+        slots_ = std::make_unique<Slot[]>(capacity_);
+        for (size_t i = 0; i < capacity_; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    // Any thread. Returns false if the queue is full.
+    bool tryPush(const T& item) {
+        uint64_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & mask_];
+            uint64_t seq = slot.sequence.load(std::memory_order_acquire);
+            int64_t diff = int64_t(seq) - int64_t(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = item;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // Consumer hasn't freed this slot yet
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer thread only
+    bool tryPop(T& item) {
+        Slot& slot = slots_[head_ & mask_];
+        if (slot.sequence.load(std::memory_order_acquire) != head_ + 1) return false;
+        item = slot.value;
+        slot.sequence.store(head_ + capacity_, std::memory_order_release);
+        ++head_;
+        popped_.store(head_, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    // Pushes claimed and pops completed so far (monotonic; safe from any thread)
+    uint64_t pushed() const { return tail_.load(std::memory_order_acquire); }
+    uint64_t popped() const { return popped_.load(std::memory_order_acquire); }
+    size_t sizeApprox() const {
+        uint64_t tail = pushed();
+        uint64_t head = popped();
+        return tail > head ? size_t(tail - head) : 0;
+    }
+
+private:
+    struct alignas(CACHE_LINE_BYTES) Slot {
+        std::atomic<uint64_t> sequence{0};
+        T value{};
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t capacity_;
+    size_t mask_;
+
+    // Producers and the consumer write different lines
+    alignas(CACHE_LINE_BYTES) std::atomic<uint64_t> tail_{0};
+    alignas(CACHE_LINE_BYTES) uint64_t head_ = 0;
+    std::atomic<uint64_t> popped_{0};
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <atomic>
+#include <type_traits>
+
+// Single-writer, many-reader publication of a small value without locks.
+//
+// The writer fills one of three slots and then publishes its index; readers copy
+// the published slot. Each slot carries a sequence number (odd while being written)
+// so a reader that raced with the writer wrapping round onto its slot notices and
+// retries. With three slots that takes two publishes during one copy, so retries
+// are rare. The writer never waits for readers.
+//
+// Slot contents are stored as relaxed atomic words, which keeps the concurrent
+// copy well-defined; T must be trivially copyable.
+
+template<typename T>
+class SnapshotBuffer {
+    static_assert(std::is_trivially_copyable_v<T>, "Snapshots are copied word by word");
+
+public:
+    SnapshotBuffer() = default;
+    SnapshotBuffer(const SnapshotBuffer&) = delete;
+    SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+    // Writer thread only (or writers serialised externally)
+    void publish(const T& value) {
+        uint32_t next = (published_.load(std::memory_order_relaxed) + 1) % SLOTS;
+        Slot& slot = slots_[next];
+
+        std::array<uint64_t, WORDS> words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+
+        uint64_t seq = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i) {
+            slot.words[i].store(words[i], std::memory_order_relaxed);
+        }
+        slot.sequence.store(seq + 2, std::memory_order_release);
+        published_.store(next, std::memory_order_release);
+    }
+
+    // Any thread; returns a consistent copy of the latest published value
+    T read() const {
+        std::array<uint64_t, WORDS> words;
+        for (;;) {
+            const Slot& slot = slots_[published_.load(std::memory_order_acquire)];
+            uint64_t before = slot.sequence.load(std::memory_order_acquire);
+            if (before & 1) continue;   // Writer is wrapping onto this slot
+            for (size_t i = 0; i < WORDS; ++i) {
+                words[i] = slot.words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == before) break;
+        }
+        T value;
+        std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr uint32_t SLOTS = 3;
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> sequence{0};
+        std::array<std::atomic<uint64_t>, WORDS> words{};
+    };
+
+    std::array<Slot, SLOTS> slots_{};
+    alignas(64) std::atomic<uint32_t> published_{0};
+};
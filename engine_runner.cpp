@@ -0,0 +1,161 @@
+#include "engine_runner.hpp"
+#include "numa_placement.hpp"
+#include "order_book.hpp"   // HFTUtils::cpuRelax
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+
+using namespace HFTUtils;
+
+namespace {
+    uint64_t steadyNowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    uint64_t threadCpuNs() {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+        timespec ts;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+            return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+        }
+#endif
+        return 0;
+    }
+
+    constexpr uint32_t IDLE_PUBLISH_INTERVAL = 1024;   // Empty polls between stats updates
+    constexpr uint64_t STATS_CPU_INTERVAL = 1024;      // Busy polls between thread CPU clock reads (a syscall)
+}
+
+const char* idleStrategyName(IdleStrategy strategy) {
+    switch (strategy) {
+        case IdleStrategy::Spin:         return "spin";
+        case IdleStrategy::Pause:        return "pause";
+        case IdleStrategy::Yield:        return "yield";
+        case IdleStrategy::BackoffSleep: return "backoff-sleep";
+    }
+    return "unknown";
+}
+
+EngineRunner::EngineRunner(const Options& options, PollFn poll, DepthFn depth)
+    : options_(options), poll_(std::move(poll)), depth_(std::move(depth)) {
+    options_.depthSampleInterval = std::max<uint32_t>(1, options_.depthSampleInterval);
+    thread_ = std::thread([this] { run(); });
+}
+
+EngineRunner::~EngineRunner() {
+    stop();
+}
+
+void EngineRunner::stop() {
+    stopping_.store(true, std::memory_order_release);
+    if (thread_.joinable()) thread_.join();
+}
+
+void EngineRunner::run() {
+    if (options_.cpu >= 0) {
+        bool pinned = HFTNuma::pinCurrentThreadToCpu(options_.cpu);
+        published_.pinned.store(pinned, std::memory_order_relaxed);
+        published_.pinFailed.store(!pinned, std::memory_order_relaxed);
+    }
+
+    const IdleOptions& idle = options_.idle;
+    startNs_ = steadyNowNs();
+    uint64_t last = startNs_;
+    bool lastBusy = false;
+    uint64_t emptyPolls = 0;
+    uint32_t sleepNs = idle.minSleepNs;
+
+    for (;;) {
+        // One clock read per poll: the time since the previous read belongs to that poll,
+        // plus its idle action when it found nothing
+        uint64_t now = steadyNowNs();
+        if (lastBusy) busyNs_ += now - last;
+        last = now;
+
+        if (polls_ % options_.depthSampleInterval == 0 && depth_) {
+            depthLast_ = depth_();
+            depthMax_ = std::max(depthMax_, depthLast_);
+            depthSum_ += depthLast_;
+            ++depthSamples_;
+        }
+
+        size_t items = poll_();
+        ++polls_;
+        lastBusy = items > 0;
+        if (lastBusy) {
+            ++busyPolls_;
+            items_ += items;
+            emptyPolls = 0;
+            sleepNs = idle.minSleepNs;
+            publish(now, busyPolls_ % STATS_CPU_INTERVAL == 0);
+            continue;
+        }
+
+        // Stop only once nothing is left in the input (a producer may have claimed a
+        // slot it has not filled yet)
+        if (stopping_.load(std::memory_order_acquire) && (!depth_ || depth_() == 0)) {
+            publish(steadyNowNs(), true);
+            break;
+        }
+
+        if (++emptyPolls % IDLE_PUBLISH_INTERVAL == 0) publish(now, true);
+
+        switch (idle.strategy) {
+            case IdleStrategy::Spin:
+                break;
+            case IdleStrategy::Pause:
+                cpuRelax();
+                break;
+            case IdleStrategy::Yield:
+                std::this_thread::yield();
+                break;
+            case IdleStrategy::BackoffSleep:
+                if (emptyPolls <= idle.spinPolls) {
+                    cpuRelax();
+                } else if (emptyPolls <= idle.spinPolls + idle.yieldPolls) {
+                    std::this_thread::yield();
+                } else {
+                    publish(now, true);
+                    std::this_thread::sleep_for(std::chrono::nanoseconds(sleepNs));
+                    ++sleeps_;
+                    sleepNs = std::min(idle.maxSleepNs, sleepNs * 2);
+                }
+                break;
+        }
+    }
+}
+
+void EngineRunner::publish(uint64_t nowNs, bool sampleCpu) {
+    published_.polls.store(polls_, std::memory_order_relaxed);
+    published_.busyPolls.store(busyPolls_, std::memory_order_relaxed);
+    published_.items.store(items_, std::memory_order_relaxed);
+    published_.sleeps.store(sleeps_, std::memory_order_relaxed);
+    published_.busyNs.store(busyNs_, std::memory_order_relaxed);
+    published_.elapsedNs.store(nowNs - startNs_, std::memory_order_relaxed);
+    published_.depthSamples.store(depthSamples_, std::memory_order_relaxed);
+    published_.depthSum.store(depthSum_, std::memory_order_relaxed);
+    published_.depth.store(depthLast_, std::memory_order_relaxed);
+    published_.depthMax.store(depthMax_, std::memory_order_relaxed);
+    if (sampleCpu) published_.cpuNs.store(threadCpuNs(), std::memory_order_relaxed);
+}
+
+EngineRunner::Stats EngineRunner::stats() const {
+    Stats stats;
+    stats.cpu = options_.cpu;
+    stats.pinned = published_.pinned.load(std::memory_order_relaxed);
+    stats.pinFailed = published_.pinFailed.load(std::memory_order_relaxed);
+    stats.polls = published_.polls.load(std::memory_order_relaxed);
+    stats.busyPolls = published_.busyPolls.load(std::memory_order_relaxed);
+    stats.items = published_.items.load(std::memory_order_relaxed);
+    stats.sleeps = published_.sleeps.load(std::memory_order_relaxed);
+    stats.busyNs = published_.busyNs.load(std::memory_order_relaxed);
+    stats.elapsedNs = published_.elapsedNs.load(std::memory_order_relaxed);
+    stats.cpuNs = published_.cpuNs.load(std::memory_order_relaxed);
+    stats.queueDepth = published_.depth.load(std::memory_order_relaxed);
+    stats.maxQueueDepth = published_.depthMax.load(std::memory_order_relaxed);
+    uint64_t samples = published_.depthSamples.load(std::memory_order_relaxed);
+    stats.meanQueueDepth = samples ? double(published_.depthSum.load(std::memory_order_relaxed)) / samples : 0.0;
+    return stats;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include "command_queue.hpp"
+
+// A dedicated engine thread: pinned to a core, busy-polling its input.
+//
+// The runner calls a poll function in a loop. Poll does whatever work is ready
+// (typically draining a batch from a CommandQueue) and returns how many items it
+// handled. When it returns 0 the idle strategy decides what the thread does before
+// polling again:
+//
+//   Spin          Poll again immediately. Lowest wakeup latency, one core at 100%.
+//   Pause         Spin with a pause hint between polls (kinder to a hyperthread sibling).
+//   Yield         Give the core to any other runnable thread, then poll.
+//   BackoffSleep  Pause, then yield, then sleep with exponential backoff; the first
+//                 item after a long quiet spell pays up to maxSleepNs of wakeup.
+//
+// Any work resets the backoff. The runner measures its duty cycle (share of wall
+// time spent in polls that found work) and samples the input queue depth.
+
+enum class IdleStrategy : uint8_t { Spin, Pause, Yield, BackoffSleep };
+
+const char* idleStrategyName(IdleStrategy strategy);
+
+struct IdleOptions {
+    IdleStrategy strategy = IdleStrategy::BackoffSleep;
+    uint32_t spinPolls = 1024;         // BackoffSleep: empty polls spent pausing
+    uint32_t yieldPolls = 1024;        // ...then yielding
+    uint32_t minSleepNs = 1000;        // ...then sleeping, doubling up to maxSleepNs
+    uint32_t maxSleepNs = 100000;
+};
+
+class EngineRunner {
+public:
+    using PollFn = std::function<size_t()>;    // Items handled; 0 when there was nothing to do
+    using DepthFn = std::function<size_t()>;   // Input backlog, e.g. CommandQueue::sizeApprox
+
+    struct Options {
+        int cpu = -1;                          // Core to pin to; -1 leaves placement to the scheduler
+        IdleOptions idle;
+        uint32_t depthSampleInterval = 64;     // Polls between queue depth samples
+    };
+
+    // The thread starts immediately
+    EngineRunner(const Options& options, PollFn poll, DepthFn depth = nullptr);
+    ~EngineRunner();
+
+    EngineRunner(const EngineRunner&) = delete;
+    EngineRunner& operator=(const EngineRunner&) = delete;
+
+    // Keeps polling until a poll finds nothing and the depth function reports an
+    // empty input, then joins. Stop feeding the input first.
+    void stop();
+
+    struct Stats {
+        int      cpu = -1;
+        bool     pinned = false;
+        bool     pinFailed = false;    // cpu was set but the affinity call was refused
+        uint64_t polls = 0;
+        uint64_t busyPolls = 0;        // Polls that found work
+        uint64_t items = 0;            // Sum of poll return values
+        uint64_t sleeps = 0;           // BackoffSleep sleeps
+        uint64_t busyNs = 0;
+        uint64_t elapsedNs = 0;        // Wall time since the thread started
+        uint64_t cpuNs = 0;            // CPU time the thread consumed (0 where unsupported)
+        size_t   queueDepth = 0;       // Latest sample
+        size_t   maxQueueDepth = 0;
+        double   meanQueueDepth = 0;
+
+        double dutyCycle() const { return elapsedNs ? double(busyNs) / double(elapsedNs) : 0.0; }
+        double cpuShare() const { return elapsedNs ? double(cpuNs) / double(elapsedNs) : 0.0; }
+    };
+
+    // Any thread; counters are published after each busy poll and periodically while idle
+    Stats stats() const;
+
+private:
+    void run();
+    void publish(uint64_t nowNs, bool sampleCpu);
+
+    Options options_;
+    PollFn poll_;
+    DepthFn depth_;
+    std::thread thread_;
+    std::atomic<bool> stopping_{false};
+
+    // Owned by the engine thread
+    uint64_t startNs_ = 0;
+    uint64_t polls_ = 0, busyPolls_ = 0, items_ = 0, sleeps_ = 0, busyNs_ = 0;
+    uint64_t depthSamples_ = 0, depthSum_ = 0;
+    size_t depthLast_ = 0, depthMax_ = 0;
+
+    // Published copies
+    struct alignas(CACHE_LINE_BYTES) Published {
+        std::atomic<bool>     pinned{false}, pinFailed{false};
+        std::atomic<uint64_t> polls{0}, busyPolls{0}, items{0}, sleeps{0};
+        std::atomic<uint64_t> busyNs{0}, elapsedNs{0}, cpuNs{0};
+        std::atomic<uint64_t> depthSamples{0}, depthSum{0};
+        std::atomic<size_t>   depth{0}, depthMax{0};
+    } published_;
+};
@@ -0,0 +1,154 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <initializer_list>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "command_queue.hpp"
+#include "book_lock.hpp"
+
+// Single-producer, multi-consumer ring buffer (the disruptor pattern).
+//
+// The producer writes events into preallocated slots and advances a published
+// cursor. Every consumer sees every event, in order, at its own pace: it tracks
+// its own sequence (events consumed) and may read up to its barrier, the minimum
+// of the cursor and the sequences of the consumers it depends on. Declaring
+// "drop copy after journal" therefore guarantees drop copy never sees an event
+// the journal has not finished with. The producer may not lap the slowest
+// consumer, so a stalled consumer eventually backpressures the producer rather
+// than losing events.
+//
+// Consumers are added before the first publish. Sequences are counts (event n is
+// in slot n % capacity), each on its own cache line; the producer and consumers
+// cache the last values they read so the shared lines are only re-read when the
+// cached bound is exhausted.
+
+template<typename T>
+class EventRing {
+public:
+    class Consumer;
+
+    explicit EventRing(size_t capacity) {
+        capacity_ = 2;
+        while (capacity_ < capacity) capacity_ <<= 1;
+        mask_ = capacity_ - 1;
+        slots_ = std::make_unique<T[]>(capacity_);
+    }
+
+    EventRing(const EventRing&) = delete;
+    EventRing& operator=(const EventRing&) = delete;
+
+    // Setup only (before publishing). The new consumer reads an event only after
+    // every consumer in `after` has consumed it.
+    Consumer& addConsumer(std::initializer_list<const Consumer*> after = {}) {
+        consumers_.push_back(std::unique_ptr<Consumer>(new Consumer(*this, after)));
+        return *consumers_.back();
+    }
+
+    // Producer thread only. Returns false if the slowest consumer is a full ring behind.
+    bool tryPublish(const T& event) {
+        uint64_t next = cursor_.load(std::memory_order_relaxed);
+        if (next - gate_ >= capacity_) {
+            gate_ = minConsumed();
+            if (next - gate_ >= capacity_) return false;
+        }
+        slots_[next & mask_] = event;
+        cursor_.store(next + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer thread only. Waits (spinning, then yielding) while the ring is full.
+    void publish(const T& event) {
+        if (tryPublish(event)) return;
+        producerWaits_.fetch_add(1, std::memory_order_relaxed);
+        for (uint32_t spins = 0; !tryPublish(event); ++spins) {
+            if (spins < SPIN_LIMIT) {
+                HFTLocks::pause();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    size_t capacity() const { return capacity_; }
+    uint64_t published() const { return cursor_.load(std::memory_order_acquire); }
+    // publish() calls that found the ring full
+    uint64_t producerWaits() const { return producerWaits_.load(std::memory_order_relaxed); }
+    size_t consumerCount() const { return consumers_.size(); }
+    const Consumer& consumer(size_t index) const { return *consumers_[index]; }
+
+    class Consumer {
+    public:
+        // Consumer thread only. Hands up to maxBatch available events to
+        // handler(const T& event, uint64_t sequence) and returns how many it handled
+        // (fits EngineRunner's poll function).
+        template<typename Handler>
+        size_t poll(Handler&& handler, size_t maxBatch = 256) {
+            uint64_t next = consumed_.load(std::memory_order_relaxed);
+            if (next == limit_) {
+                limit_ = barrier();
+                if (next == limit_) return 0;
+            }
+            uint64_t end = std::min<uint64_t>(limit_, next + maxBatch);
+            for (uint64_t seq = next; seq < end; ++seq) {
+                handler(static_cast<const T&>(ring_.slots_[seq & ring_.mask_]), seq);
+            }
+            consumed_.store(end, std::memory_order_release);
+            return size_t(end - next);
+        }
+
+        // Events this consumer has finished with
+        uint64_t consumed() const { return consumed_.load(std::memory_order_acquire); }
+
+        // Published events it has not yet consumed
+        size_t lag() const {
+            uint64_t cursor = ring_.published();
+            uint64_t done = consumed();
+            return cursor > done ? size_t(cursor - done) : 0;
+        }
+
+    private:
+        friend class EventRing;
+
+        Consumer(EventRing& ring, std::initializer_list<const Consumer*> after)
+            : ring_(ring), dependencies_(after) {}
+
+        uint64_t barrier() const {
+            uint64_t bound = ring_.cursor_.load(std::memory_order_acquire);
+            for (const Consumer* dependency : dependencies_) {
+                bound = std::min(bound, dependency->consumed_.load(std::memory_order_acquire));
+            }
+            return bound;
+        }
+
+        EventRing& ring_;
+        std::vector<const Consumer*> dependencies_;
+        uint64_t limit_ = 0;                                       // Cached barrier
+
+        alignas(CACHE_LINE_BYTES) std::atomic<uint64_t> consumed_{0};
+    };
+
+private:
+    static constexpr uint32_t SPIN_LIMIT = 1024;
+
+    uint64_t minConsumed() const {
+        uint64_t bound = cursor_.load(std::memory_order_relaxed);
+        for (const auto& consumer : consumers_) {
+            bound = std::min(bound, consumer->consumed_.load(std::memory_order_acquire));
+        }
+        return bound;
+    }
+
+    std::unique_ptr<T[]> slots_;
+    size_t capacity_;
+    size_t mask_;
+    std::vector<std::unique_ptr<Consumer>> consumers_;
+
+    // Producer-owned
+    alignas(CACHE_LINE_BYTES) std::atomic<uint64_t> cursor_{0};
+    uint64_t gate_ = 0;                                            // Cached slowest consumer
+    std::atomic<uint64_t> producerWaits_{0};
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <algorithm>
+
+// Lock-free log2-bucketed latency histogram
+// Bucket 0 holds zero samples, bucket i holds samples in [2^(i-1), 2^i) ns
+
+class LatencyHistogram {
+public:
+    static constexpr size_t BUCKETS = 64;
+
+    LatencyHistogram() = default;
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(uint64_t ns) {
+        size_t bucket = ns == 0 ? 0 : std::min<size_t>(BUCKETS - 1, 64 - __builtin_clzll(ns));
+        buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        totalNs_.fetch_add(ns, std::memory_order_relaxed);
+
+        uint64_t currentMax = maxNs_.load(std::memory_order_relaxed);
+        while (ns > currentMax) {
+            if (maxNs_.compare_exchange_weak(currentMax, ns, std::memory_order_relaxed)) break;
+        }
+    }
+
+    uint64_t getCount() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t getTotalNs() const { return totalNs_.load(std::memory_order_relaxed); }
+    uint64_t getMaxNs() const { return maxNs_.load(std::memory_order_relaxed); }
+    uint64_t getBucket(size_t i) const { return buckets_[i].load(std::memory_order_relaxed); }
+
+    double getMeanNs() const {
+        uint64_t n = getCount();
+        return n ? getTotalNs() / double(n) : 0.0;
+    }
+
+    // Upper bound of the bucket containing the given percentile (0-100)
+    uint64_t getPercentileNs(double percentile) const {
+        uint64_t n = getCount();
+        if (n == 0) return 0;
+
+        uint64_t target = static_cast<uint64_t>(n * percentile / 100.0);
+        if (target >= n) target = n - 1;
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += getBucket(i);
+            if (seen > target) {
+                return i == 0 ? 0 : std::min(getMaxNs(), (uint64_t(1) << i) - 1);
+            }
+        }
+        return getMaxNs();
+    }
+
+    // Adds another histogram's samples (e.g. one recorded per thread)
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            buckets_[i].fetch_add(other.getBucket(i), std::memory_order_relaxed);
+        }
+        count_.fetch_add(other.getCount(), std::memory_order_relaxed);
+        totalNs_.fetch_add(other.getTotalNs(), std::memory_order_relaxed);
+        uint64_t otherMax = other.getMaxNs();
+        uint64_t currentMax = maxNs_.load(std::memory_order_relaxed);
+        while (otherMax > currentMax) {
+            if (maxNs_.compare_exchange_weak(currentMax, otherMax, std::memory_order_relaxed)) break;
+        }
+    }
+
+    void reset() {
+        for (auto& b : buckets_) b.store(0, std::memory_order_relaxed);
+        count_.store(0, std::memory_order_relaxed);
+        totalNs_.store(0, std::memory_order_relaxed);
+        maxNs_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> totalNs_{0};
+    std::atomic<uint64_t> maxNs_{0};
+};
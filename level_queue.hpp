@@ -0,0 +1,199 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <utility>
+
+// FIFO of resting orders at a single price, stored structure-of-arrays so the
+// matching loop streams through the hot fields (ID, quantity, owner) and never
+// touches cold per-order data.
+//
+// Entries occupy [head, size) of one buffer laid out as ids | quantities | owners.
+// Cancelled entries become zero-quantity tombstones and are skipped; head always
+// rests on a live entry. Callers address entries by absolute position (base + index),
+// which stays valid when the consumed prefix is trimmed. Only a full compaction,
+// triggered when tombstones dominate, moves positions and reports them via callback.
+
+class LevelQueue {
+public:
+    explicit LevelQueue(std::pmr::memory_resource* mr) : mr_(mr) {}
+
+    ~LevelQueue() { release(); }
+
+    LevelQueue(const LevelQueue&) = delete;
+    LevelQueue& operator=(const LevelQueue&) = delete;
+
+    LevelQueue(LevelQueue&& other) noexcept { steal(other); }
+
+    LevelQueue& operator=(LevelQueue&& other) noexcept {
+        if (this != &other) {
+            release();
+            steal(other);
+        }
+        return *this;
+    }
+
+    bool     empty() const { return live_ == 0; }
+    uint32_t liveCount() const { return live_; }
+
+    // Raw index range, including tombstones
+    uint32_t begin() const { return head_; }
+    uint32_t end() const { return size_; }
+
+    uint64_t  id(uint32_t i) const { return ids_[i]; }
+    uint32_t& quantity(uint32_t i) { return qtys_[i]; }
+    uint32_t  quantity(uint32_t i) const { return qtys_[i]; }
+    uint32_t  owner(uint32_t i) const { return owners_[i]; }
+
+    // Contiguous arrays from head onwards (tombstones have quantity 0)
+    const uint64_t* ids() const { return ids_ + head_; }
+    const uint32_t* quantities() const { return qtys_ + head_; }
+    const uint32_t* owners() const { return owners_ + head_; }
+    uint32_t span() const { return size_ - head_; }
+
+    uint32_t positionOf(uint32_t index) const { return base_ + index; }
+    uint32_t indexOf(uint32_t position) const { return position - base_; }
+
+    // Appends an order and returns its absolute position. onMove(id, newPosition)
+    // is invoked for every live entry relocated by a full compaction.
+    template<typename OnMove>
+    uint32_t push(uint64_t id, uint32_t quantity, uint32_t owner, OnMove&& onMove) {
+        if (size_ == capacity_) makeRoom(onMove);
+        ids_[size_] = id;
+        qtys_[size_] = quantity;
+        owners_[size_] = owner;
+        ++live_;
+        return base_ + size_++;
+    }
+
+    // Removes the live entry at the head
+    void popFront() {
+        qtys_[head_] = 0;
+        --live_;
+        ++head_;
+        skipTombstones();
+    }
+
+    // Removes the live entry at the given raw index
+    void remove(uint32_t index) {
+        qtys_[index] = 0;
+        --live_;
+        if (index == head_) {
+            ++head_;
+            skipTombstones();
+        } else {
+            while (size_ > head_ && qtys_[size_ - 1] == 0) --size_;
+        }
+    }
+
+    // Empties the queue but keeps its buffer for reuse
+    void clear() {
+        head_ = size_ = live_ = 0;
+        base_ = 0;
+    }
+
+    size_t capacityBytes() const { return size_t(capacity_) * ENTRY_BYTES; }
+
+private:
+    static constexpr uint32_t INITIAL_CAPACITY = 8;
+    static constexpr size_t   ENTRY_BYTES = sizeof(uint64_t) + 2 * sizeof(uint32_t);
+
+    void skipTombstones() {
+        while (head_ < size_ && qtys_[head_] == 0) ++head_;
+        if (head_ == size_) {
+            // Fully drained: restart at the front without invalidating positions
+            base_ += head_;
+            head_ = size_ = 0;
+        }
+    }
+
+    template<typename OnMove>
+    void makeRoom(OnMove& onMove) {
+        uint32_t span = size_ - head_;
+
+        if (live_ * 2 < span && span >= 16) {
+            // Tombstone-heavy: squeeze out cancelled entries in place
+            uint32_t out = 0;
+            for (uint32_t i = head_; i < size_; ++i) {
+                if (qtys_[i] == 0) continue;
+                ids_[out] = ids_[i];
+                qtys_[out] = qtys_[i];
+                owners_[out] = owners_[i];
+                onMove(ids_[out], base_ + out);
+                ++out;
+            }
+            head_ = 0;
+            size_ = out;
+            if (size_ < capacity_) return;
+        }
+
+        if (head_ > 0 && head_ * 2 >= capacity_) {
+            // Consumed prefix dominates: slide the live range down
+            shiftToFront();
+            return;
+        }
+
+        grow(capacity_ ? capacity_ * 2 : INITIAL_CAPACITY);
+    }
+
+    void shiftToFront() {
+        uint32_t span = size_ - head_;
+        std::memmove(ids_, ids_ + head_, span * sizeof(uint64_t));
+        std::memmove(qtys_, qtys_ + head_, span * sizeof(uint32_t));
+        std::memmove(owners_, owners_ + head_, span * sizeof(uint32_t));
+        base_ += head_;
+        size_ = span;
+        head_ = 0;
+    }
+
+    void grow(uint32_t newCapacity) {
+        void* mem = mr_->allocate(newCapacity * ENTRY_BYTES, alignof(uint64_t));
+        uint64_t* ids = static_cast<uint64_t*>(mem);
+        uint32_t* qtys = reinterpret_cast<uint32_t*>(ids + newCapacity);
+        uint32_t* owners = qtys + newCapacity;
+
+        uint32_t span = size_ - head_;
+        if (span) {
+            std::memcpy(ids, ids_ + head_, span * sizeof(uint64_t));
+            std::memcpy(qtys, qtys_ + head_, span * sizeof(uint32_t));
+            std::memcpy(owners, owners_ + head_, span * sizeof(uint32_t));
+        }
+        release();
+
+        ids_ = ids;
+        qtys_ = qtys;
+        owners_ = owners;
+        capacity_ = newCapacity;
+        base_ += head_;
+        size_ = span;
+        head_ = 0;
+    }
+
+    void release() {
+        if (ids_) mr_->deallocate(ids_, capacity_ * ENTRY_BYTES, alignof(uint64_t));
+        ids_ = nullptr;
+        qtys_ = owners_ = nullptr;
+    }
+
+    void steal(LevelQueue& other) {
+        mr_ = other.mr_;
+        ids_ = std::exchange(other.ids_, nullptr);
+        qtys_ = std::exchange(other.qtys_, nullptr);
+        owners_ = std::exchange(other.owners_, nullptr);
+        capacity_ = std::exchange(other.capacity_, 0);
+        head_ = std::exchange(other.head_, 0);
+        size_ = std::exchange(other.size_, 0);
+        live_ = std::exchange(other.live_, 0);
+        base_ = std::exchange(other.base_, 0);
+    }
+
+    std::pmr::memory_resource* mr_ = nullptr;
+    uint64_t* ids_    = nullptr;
+    uint32_t* qtys_   = nullptr;
+    uint32_t* owners_ = nullptr;
+    uint32_t  capacity_ = 0;
+    uint32_t  head_ = 0;
+    uint32_t  size_ = 0;
+    uint32_t  live_ = 0;
+    uint32_t  base_ = 0;    // Absolute position of index 0
+};
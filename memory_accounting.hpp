@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+// Memory resource that forwards to an upstream resource while tracking how many
+// bytes are currently allocated through it. Not thread-safe; owners serialise access.
+
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream_(upstream) {}
+
+    CountingResource(const CountingResource&) = delete;
+    CountingResource& operator=(const CountingResource&) = delete;
+
+    size_t bytesInUse() const { return bytesInUse_; }
+    size_t peakBytes() const { return peakBytes_; }
+    uint64_t allocations() const { return allocations_; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* p = upstream_->allocate(bytes, alignment);
+        bytesInUse_ += bytes;
+        if (bytesInUse_ > peakBytes_) peakBytes_ = bytesInUse_;
+        ++allocations_;
+        return p;
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(p, bytes, alignment);
+        bytesInUse_ -= bytes;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream_;
+    size_t   bytesInUse_  = 0;
+    size_t   peakBytes_   = 0;
+    uint64_t allocations_ = 0;
+};
@@ -0,0 +1,191 @@
+#include "numa_placement.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace HFTNuma {
+namespace {
+    // Parses sysfs CPU/node lists such as "0-3,8-11"
+    std::vector<int> parseList(const std::string& text) {
+        std::vector<int> result;
+        std::stringstream ss(text);
+        std::string range;
+        while (std::getline(ss, range, ',')) {
+            if (range.empty() || range == "\n") continue;
+            size_t dash = range.find('-');
+            try {
+                int first = std::stoi(range.substr(0, dash));
+                int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+                for (int i = first; i <= last; ++i) result.push_back(i);
+            } catch (...) {
+                return {};
+            }
+        }
+        return result;
+    }
+
+    std::string readFile(const std::string& path) {
+        std::ifstream in(path);
+        std::string text;
+        std::getline(in, text);
+        return text;
+    }
+
+    std::vector<int> memoryNodes() {
+#if defined(__linux__)
+        static const std::vector<int> nodes = parseList(readFile("/sys/devices/system/node/has_memory"));
+        return nodes;
+#else
+        return {};
+#endif
+    }
+
+#if defined(__linux__)
+    // Policy constants from <numaif.h>, spelled out to avoid depending on libnuma headers
+    constexpr int MPOL_PREFERRED_MODE = 1;
+    constexpr unsigned MPOL_MF_MOVE_FLAG = 1u << 1;
+    constexpr unsigned long MPOL_F_NODE_FLAG = 1ul << 0;
+    constexpr unsigned long MPOL_F_ADDR_FLAG = 1ul << 1;
+    constexpr int MAX_NODES = 1024;
+    constexpr int MASK_WORDS = MAX_NODES / (8 * sizeof(unsigned long));
+#endif
+}
+
+int nodeCount() {
+    size_t count = memoryNodes().size();
+    return count > 0 ? static_cast<int>(count) : 1;
+}
+
+bool available() {
+    return nodeCount() > 1;
+}
+
+std::vector<int> cpusOfNode(int node) {
+#if defined(__linux__)
+    std::vector<int> cpus = parseList(readFile("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"));
+    if (!cpus.empty() || node != 0) return cpus;
+#endif
+    if (node != 0) return {};
+    std::vector<int> all;
+    for (unsigned i = 0; i < std::max(1u, std::thread::hardware_concurrency()); ++i) all.push_back(int(i));
+    return all;
+}
+
+std::vector<int> allowedCpus() {
+    std::vector<int> allowed;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    // The main thread's mask is the one taskset and cgroups set for the process
+    if (sched_getaffinity(getpid(), sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) allowed.push_back(cpu);
+        }
+    }
+#endif
+    if (allowed.empty()) return cpusOfNode(0);
+    if (memoryNodes().size() <= 1) return allowed;
+
+    // Node by node, so consecutive picks share a node; CPUs of memoryless nodes last
+    std::vector<int> ordered;
+    for (int node : memoryNodes()) {
+        for (int cpu : cpusOfNode(node)) {
+            if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end() &&
+                std::find(ordered.begin(), ordered.end(), cpu) == ordered.end()) {
+                ordered.push_back(cpu);
+            }
+        }
+    }
+    for (int cpu : allowed) {
+        if (std::find(ordered.begin(), ordered.end(), cpu) == ordered.end()) ordered.push_back(cpu);
+    }
+    return ordered;
+}
+
+int nodeOfCpu(int cpu) {
+    for (int node : memoryNodes()) {
+        for (int c : cpusOfNode(node)) {
+            if (c == cpu) return node;
+        }
+    }
+    return memoryNodes().size() <= 1 ? 0 : -1;
+}
+
+int currentCpu() {
+#if defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+int currentNode() {
+    int cpu = currentCpu();
+    return cpu >= 0 ? nodeOfCpu(cpu) : -1;
+}
+
+bool bindMemory(void* addr, size_t length, int node) {
+#if defined(__linux__) && defined(SYS_mbind)
+    if (!available() || node < 0 || node >= MAX_NODES || length == 0) return false;
+    unsigned long mask[MASK_WORDS] = {};
+    mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+    return syscall(SYS_mbind, addr, length, MPOL_PREFERRED_MODE, mask, MAX_NODES + 1, MPOL_MF_MOVE_FLAG) == 0;
+#else
+    (void)addr; (void)length; (void)node;
+    return false;
+#endif
+}
+
+int nodeOfAddress(const void* addr) {
+#if defined(__linux__) && defined(SYS_get_mempolicy)
+    if (!addr) return -1;
+    *static_cast<const volatile char*>(addr);   // Make sure the page is present
+    int node = -1;
+    if (syscall(SYS_get_mempolicy, &node, nullptr, 0, addr, MPOL_F_NODE_FLAG | MPOL_F_ADDR_FLAG) != 0) {
+        return memoryNodes().size() <= 1 ? 0 : -1;
+    }
+    return node;
+#else
+    (void)addr;
+    return -1;
+#endif
+}
+
+bool pinCurrentThreadToCpu(int cpu) {
+#if defined(__linux__)
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+bool pinCurrentThreadToNode(int node) {
+#if defined(__linux__)
+    std::vector<int> cpus = cpusOfNode(node);
+    if (cpus.empty()) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)node;
+    return false;
+#endif
+}
+}
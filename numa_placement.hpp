@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// NUMA topology, memory binding and thread pinning.
+// Uses the Linux mbind/get_mempolicy syscalls and sysfs directly, so there is no
+// libnuma dependency. On single-node hosts and other platforms every call degrades
+// to a no-op that reports failure, and callers carry on with default placement.
+
+namespace HFTNuma {
+    // Number of NUMA nodes with memory (1 when NUMA is unavailable)
+    int nodeCount();
+
+    // True when the host has more than one node and binding is supported
+    bool available();
+
+    // CPUs belonging to a node (all online CPUs for node 0 when NUMA is unavailable)
+    std::vector<int> cpusOfNode(int node);
+
+    // CPUs the process may run on (its affinity mask, so taskset and cpuset cgroups
+    // are respected), grouped node by node; every online CPU where unsupported
+    std::vector<int> allowedCpus();
+
+    // Node a CPU belongs to, or -1 if unknown
+    int nodeOfCpu(int cpu);
+
+    // CPU and node the calling thread is running on, or -1
+    int currentCpu();
+    int currentNode();
+
+    // Sets the preferred node for a range of not-yet-touched pages; pages already
+    // faulted in are migrated where the kernel allows. Returns false if unsupported.
+    bool bindMemory(void* addr, size_t length, int node);
+
+    // Node holding the page at addr (faults it in first), or -1 if unknown
+    int nodeOfAddress(const void* addr);
+
+    // Restricts the calling thread to one CPU, or to all CPUs of a node
+    bool pinCurrentThreadToCpu(int cpu);
+    bool pinCurrentThreadToNode(int node);
+}
@@ -1,14 +1,238 @@
 #include "order_book.hpp"
+#include "trace.hpp"
+#include "simd_kernels.hpp"
 #include <algorithm>
 #include <chrono>
 #include <mutex>
 
 using namespace HFTUtils;
 
-OrderBook::OrderBook(size_t maxOrders) {
+namespace {
+    uint64_t steadyNowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    // Explicit node, else the node of the engine CPU, else none
+    int placementNode(const OrderBook::MemoryOptions& memory) {
+        if (memory.numaNode >= 0) return memory.numaNode;
+        return memory.cpu >= 0 ? HFTNuma::nodeOfCpu(memory.cpu) : -1;
+    }
+
+    // Scoped guard on the book mutex (shared for read-only queries) that records
+    // wait and hold times when a site is given
+    template<bool Shared>
+    class BasicTimedLock {
+    public:
+        BasicTimedLock(BookMutex& m, OrderBook::LockSiteStats* site) : mutex_(m), site_(site) {
+            if (UNLIKELY(site_ != nullptr)) {
+                uint64_t requested = steadyNowNs();
+                acquire();
+                acquiredNs_ = steadyNowNs();
+                site_->wait.record(acquiredNs_ - requested);
+            } else {
+                acquire();
+            }
+        }
+
+        ~BasicTimedLock() {
+            if (UNLIKELY(site_ != nullptr)) {
+                site_->hold.record(steadyNowNs() - acquiredNs_);
+            }
+            if constexpr (Shared) mutex_.unlock_shared();
+            else mutex_.unlock();
+        }
+
+        BasicTimedLock(const BasicTimedLock&) = delete;
+        BasicTimedLock& operator=(const BasicTimedLock&) = delete;
+
+    private:
+        void acquire() {
+            if constexpr (Shared) mutex_.lock_shared();
+            else mutex_.lock();
+        }
+
+        BookMutex& mutex_;
+        OrderBook::LockSiteStats* site_;
+        uint64_t acquiredNs_ = 0;
+    };
+
+    using TimedLock = BasicTimedLock<false>;
+    using TimedSharedLock = BasicTimedLock<true>;
+}
+
+OrderBook::OrderBook(size_t maxOrders, std::pmr::memory_resource* upstream)
+    : OrderBook(maxOrders, upstream, nullptr) {}
+
+OrderBook::OrderBook(size_t maxOrders, const MemoryOptions& memory)
+    : OrderBook(maxOrders, nullptr, std::make_unique<ArenaResource>(
+          footprintHint(maxOrders),
+          ArenaOptions{memory.hugePages, memory.prefault, placementNode(memory)})) {
+    engineCpu_ = memory.cpu;
+    numaNode_ = placementNode(memory);
+}
+
+bool OrderBook::pinEngineThread() const {
+    if (engineCpu_ >= 0) return HFTNuma::pinCurrentThreadToCpu(engineCpu_);
+    if (numaNode_ >= 0) return HFTNuma::pinCurrentThreadToNode(numaNode_);
+    return false;
+}
+
+OrderBook::OrderBook(size_t maxOrders, std::pmr::memory_resource* upstream,
+                     std::unique_ptr<ArenaResource> arena)
+    : ownedArena_(std::move(arena)),
+      upstream_(ownedArena_ ? ownedArena_.get() : upstream),
+      orderBytes_(upstream_),
+      levelBytes_(upstream_),
+      indexBytes_(upstream_),
+      orderChunkShift_(maxOrders < SMALL_BOOK_ORDERS ? SMALL_ORDER_CHUNK_SHIFT : ORDER_CHUNK_SHIFT),
+      epochNs_(getCurrentTimeNs()) {
     orders_.reserve(maxOrders);
 }
 
+// Measured at 105-170 bytes per resting order (index buckets and nodes, cold record,
+// queue entries with growth slack, free lists), plus pool and level overhead
+size_t OrderBook::footprintHint(size_t maxOrders) {
+    constexpr size_t FIXED_BYTES = 4 << 20;
+    constexpr size_t BYTES_PER_ORDER = 192;
+    return FIXED_BYTES + maxOrders * BYTES_PER_ORDER;
+}
+
+OrderBook::~OrderBook() {
+    for (ColdOrder* chunk : orderChunks_) {
+        orderBytes_.deallocate(chunk, orderChunkSize() * sizeof(ColdOrder), alignof(ColdOrder));
+    }
+}
+
+uint32_t OrderBook::allocateOrder() {
+    if (!freeOrders_.empty()) {
+        uint32_t handle = freeOrders_.back();
+        freeOrders_.pop_back();
+        return handle;
+    }
+
+    if (orderSlots_ == orderChunks_.size() * orderChunkSize()) {
+        void* chunk = orderBytes_.allocate(orderChunkSize() * sizeof(ColdOrder), alignof(ColdOrder));
+        orderChunks_.push_back(static_cast<ColdOrder*>(chunk));
+    }
+    return orderSlots_++;
+}
+
+void OrderBook::releaseOrder(uint32_t handle) {
+    freeOrders_.push_back(handle);
+}
+
+// Drops a fully filled order from the index and its owner's list
+void OrderBook::retireOrder(uint64_t orderId, uint32_t ownerId, Side side) {
+    auto it = orders_.find(orderId);
+    unlinkOwner(it->second, ownerId, side);
+    releaseOrder(it->second);
+    orders_.erase(it);
+}
+
+// Pushes a resting order onto the front of its owner's list for its side
+void OrderBook::linkOwner(uint32_t handle, uint32_t ownerId, Side side) {
+    auto [it, inserted] = owners_.try_emplace(ownerKey(ownerId, side), NO_ORDER);
+    ColdOrder& info = cold(handle);
+    info.prevOfOwner = NO_ORDER;
+    info.nextOfOwner = it->second;
+    if (it->second != NO_ORDER) cold(it->second).prevOfOwner = handle;
+    it->second = handle;
+}
+
+void OrderBook::unlinkOwner(uint32_t handle, uint32_t ownerId, Side side) {
+    const ColdOrder& info = cold(handle);
+    if (info.nextOfOwner != NO_ORDER) cold(info.nextOfOwner).prevOfOwner = info.prevOfOwner;
+    if (info.prevOfOwner != NO_ORDER) {
+        cold(info.prevOfOwner).nextOfOwner = info.nextOfOwner;
+    } else {
+        owners_.find(ownerKey(ownerId, side))->second = info.nextOfOwner;
+    }
+}
+
+uint32_t OrderBook::acquireLevel(int64_t priceTick, Side side) {
+    uint32_t handle;
+    if (!freeLevels_.empty()) {
+        handle = freeLevels_.back();
+        freeLevels_.pop_back();
+    } else {
+        handle = static_cast<uint32_t>(levels_.size());
+        levels_.emplace_back(&queuePool_);
+    }
+
+    PriceLevel& level = levels_[handle];
+    level.priceTick = priceTick;
+    level.side = side;
+    return handle;
+}
+
+void OrderBook::releaseLevel(uint32_t handle) {
+    levels_[handle].queue.clear();
+    freeLevels_.push_back(handle);
+}
+
+// First non-empty level from the touch, skipping retained empty levels
+const OrderBook::PriceLevel* OrderBook::bestLevel(Side side) const {
+    if (side == Side::Buy) {
+        for (auto it = bids_.rbegin(); it != bids_.rend(); ++it) {
+            if (!levels_[it->second].empty()) return &levels_[it->second];
+        }
+    } else {
+        for (auto it = asks_.begin(); it != asks_.end(); ++it) {
+            if (!levels_[it->second].empty()) return &levels_[it->second];
+        }
+    }
+    return nullptr;
+}
+
+// Drops every retained empty level on one side and recycles it
+void OrderBook::compactLevels(Side side) {
+    auto& levels = (side == Side::Buy) ? bids_ : asks_;
+    for (auto it = levels.begin(); it != levels.end();) {
+        if (levels_[it->second].empty()) {
+            releaseLevel(it->second);
+            it = levels.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    emptyLevels_[sideIndex(side)] = 0;
+}
+
+uint64_t OrderBook::levelQuantity(const PriceLevel& level) const {
+    // Tombstones carry zero quantity, so a straight sum over the span is exact
+    return HFTSimd::sumQuantities(level.queue.quantities(), level.queue.span());
+}
+
+// True if the level alone fills what is still needed (ignoring excludeOwner's orders);
+// otherwise deducts the level's eligible quantity from needed
+bool OrderBook::levelCovers(const PriceLevel& level, uint32_t excludeOwner, uint32_t& needed) const {
+    uint64_t available = 0;
+    HFTSimd::findFillPrefix(level.queue.quantities(), level.queue.owners(), level.queue.span(),
+                            excludeOwner, needed, available);
+    if (available >= needed) return true;
+    needed -= static_cast<uint32_t>(available);
+    return false;
+}
+
+// Rebuilds the public view of a resting order from its hot and cold parts
+Order OrderBook::toOrder(uint32_t handle) const {
+    const ColdOrder& info = cold(handle);
+    const PriceLevel& level = levels_[info.level];
+    uint32_t index = level.queue.indexOf(info.position);
+    return Order{
+        level.queue.id(index),
+        level.side,
+        level.priceTick,
+        level.queue.quantity(index),
+        static_cast<OrderType>(info.flags & 0x1),
+        static_cast<TimeInForce>((info.flags >> 1) & 0x3),
+        level.queue.owner(index),
+        epochNs_ + uint64_t(info.timestampMs) * 1000000
+    };
+}
+
 uint64_t OrderBook::getCurrentTimeNs() const {
     return std::chrono::duration_cast<std::chrono::nanoseconds>(
         std::chrono::high_resolution_clock::now().time_since_epoch()
@@ -16,25 +240,39 @@ uint64_t OrderBook::getCurrentTimeNs() const {
 }
 
 bool OrderBook::submitOrder(const Order& o, std::vector<Fill>* fills) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    TRACE_SCOPE(Submit, o.id);
+    TRACE_SCOPE_VAR(lockSpan, LockAcquire, o.id);
+    TimedLock lock(mutex_, lockSite(LockSite::Submit));
+    TRACE_FINISH(lockSpan);
 
     uint64_t startTime = getCurrentTimeNs();
 
-    // FOK orders must fully execute or fail immediately
-    if (UNLIKELY(o.tif == TimeInForce::FOK && !canFullyFill(o))) {
+    // Order IDs must be unique among resting orders
+    if (UNLIKELY(orders_.count(o.id) != 0)) {
         return false;
     }
 
+    // FOK orders must fully execute or fail immediately
+    if (o.tif == TimeInForce::FOK) {
+        TRACE_SCOPE(FokCheck, o.id);
+        if (UNLIKELY(!canFullyFill(o))) {
+            return false;
+        }
+    }
+
     uint32_t remaining = o.quantity;
     matchLoop(o, remaining, fills);
+    if (remaining != o.quantity) markDepthDirty();
 
     // Place unfilled quantity on the book (except IOC/FOK)
     if (remaining > 0) {
         if (UNLIKELY(o.tif == TimeInForce::IOC || o.tif == TimeInForce::FOK)) {
+            maybePublishDepth();
             return true;
         }
         restOrder(o, remaining);
     }
+    maybePublishDepth();
 
     uint64_t processingTime = getCurrentTimeNs() - startTime;
     stats_.ordersProcessed.fetch_add(1, std::memory_order_relaxed);
@@ -43,27 +281,53 @@ bool OrderBook::submitOrder(const Order& o, std::vector<Fill>* fills) {
     return true;
 }
 
+void OrderBook::prefetchLevelHead(uint32_t handle) const {
+    const LevelQueue& queue = levels_[handle].queue;
+    PREFETCH(queue.ids());
+    PREFETCH(queue.quantities());
+    PREFETCH(queue.owners());
+}
+
+// Called on entering a level: warms the next crossing level's queue head and the
+// level record after it, so a sweep does not stall at each level boundary
+template<typename Iterator>
+void OrderBook::prefetchAhead(Iterator next, Iterator end, int64_t limitTick, bool ascending) const {
+    if (next == end || (ascending ? next->first > limitTick : next->first < limitTick)) return;
+    prefetchLevelHead(next->second);
+    if (++next != end) PREFETCH(&levels_[next->second]);
+}
+
 void OrderBook::matchLoop(const Order& incomingOrder, uint32_t& remaining, std::vector<Fill>* fills) {
+    TRACE_SCOPE(Match, incomingOrder.id);
     auto& contraLevels = (incomingOrder.side == Side::Buy) ? asks_ : bids_;
 
     if (incomingOrder.side == Side::Buy) {
         // Buy orders match against asks, starting from lowest price
         auto it = contraLevels.begin();
         while (remaining > 0 && it != contraLevels.end() && it->first <= incomingOrder.priceTick) {
-            auto& queue = it->second;
+            LevelQueue& queue = levels_[it->second].queue;
+            if (queue.empty()) {
+                ++it;   // Retained empty level
+                continue;
+            }
+            if constexpr (prefetchEnabled) {
+                prefetchAhead(std::next(it), contraLevels.end(), incomingOrder.priceTick, true);
+            }
 
             while (remaining > 0 && !queue.empty()) {
-                Order* restingOrder = queue.front();
+                uint32_t front = queue.begin();
 
                 // Prevent wash trades
-                if (UNLIKELY(restingOrder->ownerId == incomingOrder.ownerId)) {
+                if (UNLIKELY(queue.owner(front) == incomingOrder.ownerId)) {
                     break;
                 }
 
-                uint32_t fillQty = std::min(remaining, restingOrder->quantity);
+                uint64_t restingId = queue.id(front);
+                uint32_t& restingQty = queue.quantity(front);
+                uint32_t fillQty = std::min(remaining, restingQty);
                 
                 Fill fill{
-                    restingOrder->id,
+                    restingId,
                     incomingOrder.id,
                     fillQty,
                     it->first,
@@ -71,42 +335,53 @@ void OrderBook::matchLoop(const Order& incomingOrder, uint32_t& remaining, std::
                 };
                 
                 if (fills) fills->push_back(fill);
-                if (fillCb_) fillCb_(fill);
+                if (fillCb_) {
+                    TRACE_SCOPE(Callback, restingId);
+                    fillCb_(fill);
+                }
                 
-                restingOrder->quantity -= fillQty;
+                restingQty -= fillQty;
                 remaining -= fillQty;
                 
-                if (restingOrder->quantity == 0) {
-                    orders_.erase(restingOrder->id);
-                    queue.pop_front();
+                if (restingQty == 0) {
+                    uint32_t restingOwner = queue.owner(front);
+                    queue.popFront();
+                    retireOrder(restingId, restingOwner, Side::Sell);
                 }
                 
                 stats_.fillsGenerated.fetch_add(1, std::memory_order_relaxed);
             }
             
-            if (queue.empty()) {
-                it = contraLevels.erase(it);
-            } else {
-                ++it;
-            }
+            // Emptied levels stay in the map for reuse
+            if (queue.empty()) levelEmptied(Side::Sell);
+            ++it;
         }
     } else {
         // Sell orders match against bids, starting from highest price
         auto it = contraLevels.rbegin();
         while (remaining > 0 && it != contraLevels.rend() && it->first >= incomingOrder.priceTick) {
-            auto& queue = it->second;
+            LevelQueue& queue = levels_[it->second].queue;
+            if (queue.empty()) {
+                ++it;   // Retained empty level
+                continue;
+            }
+            if constexpr (prefetchEnabled) {
+                prefetchAhead(std::next(it), contraLevels.rend(), incomingOrder.priceTick, false);
+            }
 
             while (remaining > 0 && !queue.empty()) {
-                Order* restingOrder = queue.front();
+                uint32_t front = queue.begin();
                 
-                if (UNLIKELY(restingOrder->ownerId == incomingOrder.ownerId)) {
+                if (UNLIKELY(queue.owner(front) == incomingOrder.ownerId)) {
                     break;
                 }
                 
-                uint32_t fillQty = std::min(remaining, restingOrder->quantity);
+                uint64_t restingId = queue.id(front);
+                uint32_t& restingQty = queue.quantity(front);
+                uint32_t fillQty = std::min(remaining, restingQty);
                 
                 Fill fill{
-                    restingOrder->id,
+                    restingId,
                     incomingOrder.id,
                     fillQty,
                     it->first,
@@ -114,43 +389,58 @@ void OrderBook::matchLoop(const Order& incomingOrder, uint32_t& remaining, std::
                 };
                 
                 if (fills) fills->push_back(fill);
-                if (fillCb_) fillCb_(fill);
+                if (fillCb_) {
+                    TRACE_SCOPE(Callback, restingId);
+                    fillCb_(fill);
+                }
                 
-                restingOrder->quantity -= fillQty;
+                restingQty -= fillQty;
                 remaining -= fillQty;
                 
-                if (restingOrder->quantity == 0) {
-                    orders_.erase(restingOrder->id);
-                    queue.pop_front();
+                if (restingQty == 0) {
+                    uint32_t restingOwner = queue.owner(front);
+                    queue.popFront();
+                    retireOrder(restingId, restingOwner, Side::Buy);
                 }
                 
                 stats_.fillsGenerated.fetch_add(1, std::memory_order_relaxed);
             }
             
-            if (queue.empty()) {
-                // Erase empty price level and restart iteration
-                auto forward_it = std::next(it).base();
-                contraLevels.erase(forward_it);
-                it = contraLevels.rbegin();
-            } else {
-                ++it;
-            }
+            if (queue.empty()) levelEmptied(Side::Buy);
+            ++it;
         }
     }
+
+    maybeCompactLevels(incomingOrder.side == Side::Buy ? Side::Sell : Side::Buy);
 }
 
 void OrderBook::restOrder(const Order& order, uint32_t remaining) {
-    Order newOrder = order;
-    newOrder.quantity = remaining;
-    newOrder.timestamp = getCurrentTimeNs();
-
-    orders_[order.id] = newOrder;
-    Order* orderPtr = &orders_[order.id];
-
+    TRACE_SCOPE(Rest, order.id);
     auto& levels = (order.side == Side::Buy) ? bids_ : asks_;
-    levels[order.priceTick].push_back(orderPtr);
+    auto [levelIt, inserted] = levels.try_emplace(order.priceTick, 0u);
+    if (inserted) {
+        levelIt->second = acquireLevel(order.priceTick, order.side);
+    } else if (levels_[levelIt->second].empty()) {
+        --emptyLevels_[sideIndex(order.side)];   // Reviving a retained level
+    }
+
+    // A compaction inside push relocates live entries; keep their cold positions in sync
+    uint32_t position = levels_[levelIt->second].queue.push(order.id, remaining, order.ownerId,
+        [this](uint64_t movedId, uint32_t newPosition) {
+            cold(orders_.find(movedId)->second).position = newPosition;
+        });
+
+    uint32_t handle = allocateOrder();
+    ColdOrder& info = cold(handle);
+    info.level = levelIt->second;
+    info.position = position;
+    info.flags = static_cast<uint32_t>(order.type) | (static_cast<uint32_t>(order.tif) << 1);
+    info.timestampMs = static_cast<uint32_t>((getCurrentTimeNs() - epochNs_) / 1000000);
+    orders_.emplace(order.id, handle);
+    linkOwner(handle, order.ownerId, order.side);
 
     orderCount_.fetch_add(1, std::memory_order_relaxed);
+    noteDepthChange(order.side, order.priceTick);
 
     // Update best prices atomically
     if (order.side == Side::Buy) {
@@ -171,28 +461,16 @@ bool OrderBook::canFullyFill(const Order& order) const {
     const auto& contraLevels = (order.side == Side::Buy) ? asks_ : bids_;
     
     if (order.side == Side::Buy) {
-        for (const auto& [price, queue] : contraLevels) {
+        for (const auto& [price, levelHandle] : contraLevels) {
             if (price > order.priceTick) break;
             
-            for (const Order* restingOrder : queue) {
-                if (restingOrder->ownerId == order.ownerId) continue;
-                
-                if (restingOrder->quantity >= needed) return true;
-                needed -= restingOrder->quantity;
-                if (needed == 0) return true;
-            }
+            if (levelCovers(levels_[levelHandle], order.ownerId, needed)) return true;
         }
     } else {
         for (auto it = contraLevels.rbegin(); it != contraLevels.rend(); ++it) {
             if (it->first < order.priceTick) break;
             
-            for (const Order* restingOrder : it->second) {
-                if (restingOrder->ownerId == order.ownerId) continue;
-                
-                if (restingOrder->quantity >= needed) return true;
-                needed -= restingOrder->quantity;
-                if (needed == 0) return true;
-            }
+            if (levelCovers(levels_[it->second], order.ownerId, needed)) return true;
         }
     }
     
@@ -200,164 +478,378 @@ bool OrderBook::canFullyFill(const Order& order) const {
 }
 
 double OrderBook::bestBid() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (bids_.empty()) return -1.0;
-    return bids_.rbegin()->first / double(TICK_PRECISION);
+    TimedSharedLock lock(mutex_, lockSite(LockSite::BestBid));
+    const PriceLevel* level = bestLevel(Side::Buy);
+    if (!level) return -1.0;
+    return level->priceTick / double(TICK_PRECISION);
 }
 
 double OrderBook::bestAsk() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (asks_.empty()) return -1.0;
-    return asks_.begin()->first / double(TICK_PRECISION);
+    TimedSharedLock lock(mutex_, lockSite(LockSite::BestAsk));
+    const PriceLevel* level = bestLevel(Side::Sell);
+    if (!level) return -1.0;
+    return level->priceTick / double(TICK_PRECISION);
 }
 
-std::vector<LevelInfo> OrderBook::getTopLevels(Side side, size_t depth) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    std::vector<LevelInfo> result;
-    result.reserve(depth);
-    
-    const auto& levels = (side == Side::Buy) ? bids_ : asks_;
-    
+// Best non-empty levels of a side, best first
+size_t OrderBook::collectLevels(Side side, LevelInfo* out, size_t depth) const {
+    size_t count = 0;
+    auto emit = [&](int64_t priceTick, uint32_t handle) {
+        const PriceLevel& level = levels_[handle];
+        if (level.empty()) return;
+        out[count++] = {priceTick, levelQuantity(level), level.queue.liveCount(), 0};
+    };
+
     if (side == Side::Buy) {
         // Bids: highest price first
-        for (auto it = levels.rbegin(); it != levels.rend() && result.size() < depth; ++it) {
-            uint64_t totalQty = 0;
-            for (const Order* order : it->second) {
-                totalQty += order->quantity;
-            }
-            result.push_back({
-                it->first,
-                totalQty,
-                static_cast<uint32_t>(it->second.size()),
-                0
-            });
-        }
+        for (auto it = bids_.rbegin(); it != bids_.rend() && count < depth; ++it) emit(it->first, it->second);
     } else {
         // Asks: lowest price first
-        for (auto it = levels.begin(); it != levels.end() && result.size() < depth; ++it) {
-            uint64_t totalQty = 0;
-            for (const Order* order : it->second) {
-                totalQty += order->quantity;
-            }
-            result.push_back({
-                it->first,
-                totalQty,
-                static_cast<uint32_t>(it->second.size()),
-                0
-            });
-        }
+        for (auto it = asks_.begin(); it != asks_.end() && count < depth; ++it) emit(it->first, it->second);
     }
-    
+    return count;
+}
+
+std::vector<LevelInfo> OrderBook::getTopLevels(Side side, size_t depth) const {
+    // Shallow requests are served from the published snapshot without locking
+    const DepthState* state = depth <= SNAPSHOT_DEPTH ? depth_.load(std::memory_order_acquire) : nullptr;
+    if (state) {
+        DepthSnapshot snapshot = state->buffer.read();
+        const LevelInfo* levels = (side == Side::Buy) ? snapshot.bids.data() : snapshot.asks.data();
+        size_t available = (side == Side::Buy) ? snapshot.bidLevels : snapshot.askLevels;
+        return std::vector<LevelInfo>(levels, levels + std::min(depth, available));
+    }
+
+    TimedSharedLock lock(mutex_, lockSite(LockSite::TopLevels));
+    std::vector<LevelInfo> result(depth);
+    result.resize(collectLevels(side, result.data(), depth));
     return result;
 }
 
+void OrderBook::publishDepth(DepthState& depth) {
+    DepthSnapshot snapshot;
+    snapshot.version = ++depth.version;
+    snapshot.bidLevels = static_cast<uint32_t>(collectLevels(Side::Buy, snapshot.bids.data(), SNAPSHOT_DEPTH));
+    snapshot.askLevels = static_cast<uint32_t>(collectLevels(Side::Sell, snapshot.asks.data(), SNAPSHOT_DEPTH));
+
+    // Changes beyond the last published level of a full side can't alter the snapshot
+    depth.visibleBound[0] = snapshot.bidLevels == SNAPSHOT_DEPTH ? snapshot.bids.back().priceTick : INT64_MIN;
+    depth.visibleBound[1] = snapshot.askLevels == SNAPSHOT_DEPTH ? snapshot.asks.back().priceTick : INT64_MAX;
+    depth.dirty = false;
+    depth.buffer.publish(snapshot);
+}
+
+void OrderBook::setDepthSnapshotEnabled(bool enabled) {
+    TimedLock lock(mutex_, nullptr);
+    if (!enabled) {
+        depth_.store(nullptr, std::memory_order_release);
+        return;
+    }
+    if (!depthState()) {
+        // Publication stopped while disabled; bring the snapshot up to date before
+        // readers can see it again
+        if (!depthStorage_) depthStorage_ = std::make_unique<DepthState>();
+        publishDepth(*depthStorage_);
+        depth_.store(depthStorage_.get(), std::memory_order_release);
+    }
+}
+
+bool OrderBook::readDepthSnapshot(DepthSnapshot& out) const {
+    const DepthState* state = depth_.load(std::memory_order_acquire);
+    if (!state) return false;
+    out = state->buffer.read();
+    return true;
+}
+
 uint64_t OrderBook::getTotalVolume(Side side) const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    TimedSharedLock lock(mutex_, lockSite(LockSite::TotalVolume));
     uint64_t total = 0;
     const auto& levels = (side == Side::Buy) ? bids_ : asks_;
     
-    for (const auto& [price, queue] : levels) {
-        for (const Order* order : queue) {
-            total += order->quantity;
-        }
+    for (const auto& [price, levelHandle] : levels) {
+        total += levelQuantity(levels_[levelHandle]);
     }
     
     return total;
 }
 
 double OrderBook::getWeightedMidPrice() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (bids_.empty() || asks_.empty()) return -1.0;
+    TimedSharedLock lock(mutex_, lockSite(LockSite::WeightedMid));
+    const PriceLevel* bidLevel = bestLevel(Side::Buy);
+    const PriceLevel* askLevel = bestLevel(Side::Sell);
+    if (!bidLevel || !askLevel) return -1.0;
 
-    double bid = bids_.rbegin()->first / double(TICK_PRECISION);
-    double ask = asks_.begin()->first / double(TICK_PRECISION);
+    double bid = bidLevel->priceTick / double(TICK_PRECISION);
+    double ask = askLevel->priceTick / double(TICK_PRECISION);
 
     // Calculate volume-weighted mid price
-    uint64_t bidVol = 0, askVol = 0;
-    for (const Order* order : bids_.rbegin()->second) {
-        bidVol += order->quantity;
-    }
-    for (const Order* order : asks_.begin()->second) {
-        askVol += order->quantity;
-    }
+    uint64_t bidVol = levelQuantity(*bidLevel);
+    uint64_t askVol = levelQuantity(*askLevel);
 
     if (bidVol + askVol == 0) return (bid + ask) / 2.0;
     return (bid * askVol + ask * bidVol) / (bidVol + askVol);
 }
 
 bool OrderBook::cancelOrder(uint64_t orderId) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    TRACE_SCOPE(Cancel, orderId);
+    TRACE_SCOPE_VAR(lockSpan, LockAcquire, orderId);
+    TimedLock lock(mutex_, lockSite(LockSite::Cancel));
+    TRACE_FINISH(lockSpan);
     
     auto it = orders_.find(orderId);
     if (it == orders_.end()) return false;
     
-    const Order& order = it->second;
-    auto& levels = (order.side == Side::Buy) ? bids_ : asks_;
-    
-    auto levelIt = levels.find(order.priceTick);
-    if (levelIt != levels.end()) {
-        auto& queue = levelIt->second;
-        queue.erase(std::remove_if(queue.begin(), queue.end(),
-                       [orderId](const Order* o) { return o->id == orderId; }),
-                   queue.end());
-        
-        if (queue.empty()) {
-            levels.erase(levelIt);
-        }
-    }
+    uint32_t handle = it->second;
+    const ColdOrder& info = cold(handle);
+    PriceLevel& level = levels_[info.level];
+    uint32_t index = level.queue.indexOf(info.position);
+    unlinkOwner(handle, level.queue.owner(index), level.side);
+    level.queue.remove(index);
     
     orders_.erase(it);
+    releaseOrder(handle);
     orderCount_.fetch_sub(1, std::memory_order_relaxed);
+
+    // The emptied level stays in the map for reuse
+    if (level.empty()) {
+        levelEmptied(level.side);
+        maybeCompactLevels(level.side);
+    }
+    noteDepthChange(level.side, level.priceTick);
+    maybePublishDepth();
     return true;
 }
 
 std::vector<Fill> OrderBook::modifyOrder(uint64_t orderId, int64_t newPrice, uint32_t newQty) {
     std::vector<Fill> fills;
+    modifyOrder(orderId, newPrice, newQty, &fills);
+    return fills;
+}
 
+bool OrderBook::modifyOrder(uint64_t orderId, int64_t newPrice, uint32_t newQty, std::vector<Fill>* fills) {
     Order originalOrder;
     bool found = false;
 
     {
-        std::lock_guard<std::mutex> lock(mutex_);
+        TimedSharedLock lock(mutex_, lockSite(LockSite::Modify));
         auto it = orders_.find(orderId);
         if (it != orders_.end()) {
-            originalOrder = it->second;
+            originalOrder = toOrder(it->second);
             found = true;
         }
     }
 
-    if (found) {
-        // Modification implemented as cancel + resubmit
-        cancelOrder(orderId);
+    if (!found) return false;
 
-        Order modifiedOrder = originalOrder;
-        modifiedOrder.priceTick = newPrice;
-        modifiedOrder.quantity = newQty;
+    // Modification implemented as cancel + resubmit
+    cancelOrder(orderId);
 
-        submitOrder(modifiedOrder, &fills);
-    }
+    Order modifiedOrder = originalOrder;
+    modifiedOrder.priceTick = newPrice;
+    modifiedOrder.quantity = newQty;
 
-    return fills;
+    return submitOrder(modifiedOrder, fills);
 }
 
 void OrderBook::cancelAll(Side side) {
-    std::vector<uint64_t> toCancel;
+    TimedLock lock(mutex_, lockSite(LockSite::CancelAll));
+    auto& levels = (side == Side::Buy) ? bids_ : asks_;
+    uint64_t removed = 0;
+    for (const auto& [price, levelHandle] : levels) {
+        LevelQueue& queue = levels_[levelHandle].queue;
+        for (uint32_t i = queue.begin(); i < queue.end(); ++i) {
+            if (queue.quantity(i) == 0) continue;
+            auto it = orders_.find(queue.id(i));
+            releaseOrder(it->second);
+            orders_.erase(it);
+            ++removed;
+        }
+        queue.clear();
+    }
+
+    // Every owner's list for this side is now empty, and so is every level
+    for (auto& [key, head] : owners_) {
+        if ((key & 1) == sideIndex(side)) head = NO_ORDER;
+    }
+    compactLevels(side);
+    orderCount_.fetch_sub(removed, std::memory_order_relaxed);
+    markDepthDirty();
+    maybePublishDepth();
+}
+
+// Cancels one owner's list for one side, front to back (lock held)
+void OrderBook::cancelOwnerSide(uint32_t ownerId, Side side, MassCancel& result, std::vector<uint64_t>* cancelled) {
+    auto head = owners_.find(ownerKey(ownerId, side));
+    if (head == owners_.end()) return;
+
+    uint32_t removed = 0;
+    for (uint32_t handle = head->second; handle != NO_ORDER;) {
+        const ColdOrder& info = cold(handle);
+        uint32_t next = info.nextOfOwner;
+        PriceLevel& level = levels_[info.level];
+        uint32_t index = level.queue.indexOf(info.position);
+        uint64_t id = level.queue.id(index);
+
+        result.quantity += level.queue.quantity(index);
+        if (cancelled) cancelled->push_back(id);
+        level.queue.remove(index);
+        if (level.empty()) levelEmptied(side);
+        noteDepthChange(side, level.priceTick);
+
+        orders_.erase(id);
+        releaseOrder(handle);
+        ++removed;
+        handle = next;
+    }
+    head->second = NO_ORDER;
+
+    result.orders += removed;
+    orderCount_.fetch_sub(removed, std::memory_order_relaxed);
+    maybeCompactLevels(side);
+}
+
+OrderBook::MassCancel OrderBook::cancelOwner(uint32_t ownerId, std::vector<uint64_t>* cancelled) {
+    TimedLock lock(mutex_, lockSite(LockSite::CancelOwner));
+    MassCancel result;
+    cancelOwnerSide(ownerId, Side::Buy, result, cancelled);
+    cancelOwnerSide(ownerId, Side::Sell, result, cancelled);
+    maybePublishDepth();
+    return result;
+}
 
+OrderBook::MassCancel OrderBook::cancelOwner(uint32_t ownerId, Side side, std::vector<uint64_t>* cancelled) {
+    TimedLock lock(mutex_, lockSite(LockSite::CancelOwner));
+    MassCancel result;
+    cancelOwnerSide(ownerId, side, result, cancelled);
+    maybePublishDepth();
+    return result;
+}
+
+uint32_t OrderBook::getOwnerOrderCount(uint32_t ownerId, Side side) const {
+    TimedSharedLock lock(mutex_, nullptr);
+    auto head = owners_.find(ownerKey(ownerId, side));
+    uint32_t count = 0;
+    if (head == owners_.end()) return count;
+    for (uint32_t handle = head->second; handle != NO_ORDER; handle = cold(handle).nextOfOwner) ++count;
+    return count;
+}
+
+bool OrderBook::warmup(size_t rounds) {
+    FillHandler savedHandler;
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        for (const auto& [id, order] : orders_) {
-            if (order.side == side) {
-                toCancel.push_back(id);
+        TimedLock lock(mutex_, nullptr);
+        if (!orders_.empty()) return false;
+        savedHandler = std::move(fillCb_);
+        fillCb_ = nullptr;
+    }
+
+    const uint64_t savedCount = orderCount_.load();
+    const int64_t savedBestBid = bestBidTick_.load();
+    const int64_t savedBestAsk = bestAskTick_.load();
+    const uint64_t savedProcessed = stats_.ordersProcessed.load();
+    const uint64_t savedFills = stats_.fillsGenerated.load();
+    const uint64_t savedAvg = stats_.avgProcessingTimeNs.load();
+    const uint64_t savedPeak = stats_.peakOrdersPerSecond.load();
+
+    // Synthetic IDs from the top of the range; two owners so matching is not blocked
+    constexpr uint64_t FIRST_ID = UINT64_MAX - (uint64_t(1) << 40);
+    constexpr int64_t  MID = 1000000;
+    constexpr uint32_t MAKER = UINT32_MAX - 1;
+    constexpr uint32_t TAKER = UINT32_MAX - 2;
+    constexpr int      DEPTH = 4;
+
+    uint64_t nextId = FIRST_ID;
+    std::vector<uint64_t> resting;
+    std::vector<Fill> fills;
+    resting.reserve(4 * DEPTH);
+    fills.reserve(4 * DEPTH);
+
+    for (size_t round = 0; round < rounds; ++round) {
+        resting.clear();
+
+        // Two orders per level on both sides
+        for (int level = 0; level < DEPTH; ++level) {
+            for (int k = 0; k < 2; ++k) {
+                uint64_t bidId = nextId++;
+                uint64_t askId = nextId++;
+                submitOrder({bidId, Side::Buy, MID - 1 - level, 10, OrderType::Limit, TimeInForce::GTC, MAKER, 0}, &fills);
+                submitOrder({askId, Side::Sell, MID + 1 + level, 10, OrderType::Limit, TimeInForce::GTC, MAKER, 0}, &fills);
+                resting.push_back(bidId);
+                resting.push_back(askId);
             }
         }
+
+        // Amend and cancel mid-queue entries, then read the book
+        modifyOrder(resting[2], MID - 1, 15, &fills);
+        cancelOrder(resting[5]);
+        bestBid();
+        bestAsk();
+        getTopLevels(Side::Buy, DEPTH);
+        getWeightedMidPrice();
+
+        // A FOK that is rejected, one that fills across levels, then sweeps that
+        // partially fill and clear what remains on each side
+        fills.clear();
+        submitOrder({nextId++, Side::Buy, MID + DEPTH, 1000, OrderType::Limit, TimeInForce::FOK, TAKER, 0}, &fills);
+        submitOrder({nextId++, Side::Buy, MID + 2, 25, OrderType::Limit, TimeInForce::FOK, TAKER, 0}, &fills);
+        fills.clear();
+        submitOrder({nextId++, Side::Buy, MID + DEPTH, 1000, OrderType::Limit, TimeInForce::IOC, TAKER, 0}, &fills);
+        fills.clear();
+        submitOrder({nextId++, Side::Sell, MID - DEPTH, 1000, OrderType::Limit, TimeInForce::IOC, TAKER, 0}, &fills);
+        fills.clear();
+
+        for (uint64_t id : resting) cancelOrder(id);
     }
 
-    for (uint64_t id : toCancel) {
-        cancelOrder(id);
+    {
+        TimedLock lock(mutex_, nullptr);
+        // Leave no empty warmup levels for queries to skip
+        compactLevels(Side::Buy);
+        compactLevels(Side::Sell);
+        owners_.clear();
+        fillCb_ = std::move(savedHandler);
     }
+
+    orderCount_.store(savedCount);
+    bestBidTick_.store(savedBestBid);
+    bestAskTick_.store(savedBestAsk);
+    stats_.ordersProcessed.store(savedProcessed);
+    stats_.fillsGenerated.store(savedFills);
+    stats_.avgProcessingTimeNs.store(savedAvg);
+    stats_.peakOrdersPerSecond.store(savedPeak);
+    // The synthetic session's acquisitions would otherwise dominate the histograms
+    stats_.resetLockStats();
+    return true;
+}
+
+void OrderBook::setConcurrencyMode(ConcurrencyMode mode) {
+    mutex_.setMode(mode);
+}
+
+void OrderBook::setLockStatsEnabled(bool enabled) {
+    if (enabled && !stats_.lockSites.load(std::memory_order_acquire)) {
+        auto* sites = new Stats::LockSiteArray();
+        Stats::LockSiteArray* expected = nullptr;
+        if (!stats_.lockSites.compare_exchange_strong(expected, sites, std::memory_order_acq_rel)) {
+            delete sites;   // Another thread got there first
+        }
+    }
+    lockStatsEnabled_.store(enabled, std::memory_order_relaxed);
 }
 
 void OrderBook::setFillHandler(FillHandler handler) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    TimedLock lock(mutex_, lockSite(LockSite::SetFillHandler));
     fillCb_ = std::move(handler);
-}
\ No newline at end of file
+}
+
+OrderBook::MemoryUsage OrderBook::memoryUsage() const {
+    TimedSharedLock lock(mutex_, lockSite(LockSite::MemoryUsage));
+    MemoryUsage usage;
+    usage.orderBytes = orderBytes_.bytesInUse();
+    usage.levelBytes = levelBytes_.bytesInUse();
+    usage.indexBytes = indexBytes_.bytesInUse();
+    usage.bufferBytes = sizeof(OrderBook);
+    if (stats_.lockSites.load(std::memory_order_acquire)) usage.bufferBytes += sizeof(Stats::LockSiteArray);
+    usage.restingOrders = orders_.size();
+    return usage;
+}
@@ -2,11 +2,19 @@
 #include <cstdint>
 #include <vector>
 #include <map>
-#include <deque>
 #include <unordered_map>
+#include <memory_resource>
 #include <functional>
 #include <atomic>
 #include <mutex>
+#include <array>
+#include <memory>
+#include "latency_histogram.hpp"
+#include "memory_accounting.hpp"
+#include "arena_resource.hpp"
+#include "level_queue.hpp"
+#include "book_lock.hpp"
+#include "depth_snapshot.hpp"
 
 // High-performance order matching engine for HFT applications
 // Thread-safe implementation using mutex + atomics
@@ -45,30 +53,154 @@ struct LevelInfo {
     uint32_t   padding;      // Alignment padding
 };
 
+// Call sites that acquire the book mutex (for lock contention statistics)
+enum class LockSite : uint8_t {
+    Submit,
+    Cancel,
+    Modify,
+    CancelAll,
+    CancelOwner,
+    BestBid,
+    BestAsk,
+    TopLevels,
+    TotalVolume,
+    WeightedMid,
+    SetFillHandler,
+    MemoryUsage,
+    Count
+};
+
+inline const char* lockSiteName(LockSite site) {
+    switch (site) {
+        case LockSite::Submit:         return "submitOrder";
+        case LockSite::Cancel:         return "cancelOrder";
+        case LockSite::Modify:         return "modifyOrder";
+        case LockSite::CancelAll:      return "cancelAll";
+        case LockSite::CancelOwner:    return "cancelOwner";
+        case LockSite::BestBid:        return "bestBid";
+        case LockSite::BestAsk:        return "bestAsk";
+        case LockSite::TopLevels:      return "getTopLevels";
+        case LockSite::TotalVolume:    return "getTotalVolume";
+        case LockSite::WeightedMid:    return "getWeightedMidPrice";
+        case LockSite::SetFillHandler: return "setFillHandler";
+        case LockSite::MemoryUsage:    return "memoryUsage";
+        default:                       return "unknown";
+    }
+}
+
 class OrderBook {
 public:
-    OrderBook(size_t maxOrders = 1000000);
-    ~OrderBook() = default;
+    // Every internal container allocates (through the book's own pools) from upstream,
+    // so a book can live in a dedicated arena: OrderBook book(maxOrders, &arena);
+    OrderBook(size_t maxOrders = 1000000,
+              std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+    // Book-owned arena sized from maxOrders (see footprintHint)
+    struct MemoryOptions {
+        bool hugePages = false;   // 2 MB pages where the OS allows, regular pages otherwise
+        bool prefault  = true;    // Fault every page in at construction
+        int  numaNode  = -1;      // Place all storage on this node (-1: node of cpu, else first touch)
+        int  cpu       = -1;      // CPU the engine thread will run on (see pinEngineThread)
+    };
+    OrderBook(size_t maxOrders, const MemoryOptions& memory);
+    ~OrderBook();
 
     // Core operations
     bool submitOrder(const Order& order, std::vector<Fill>* fills = nullptr);
     bool cancelOrder(uint64_t orderId);
     std::vector<Fill> modifyOrder(uint64_t orderId, int64_t newPrice, uint32_t newQty);
+    bool modifyOrder(uint64_t orderId, int64_t newPrice, uint32_t newQty, std::vector<Fill>* fills);
     void cancelAll(Side side);
 
+    // Kill switch: cancels every resting order of one owner (or one owner and side)
+    // under a single lock acquisition, walking only that owner's orders. The IDs
+    // cancelled are appended to `cancelled` if given, so the caller can publish
+    // them as one batch.
+    struct MassCancel {
+        uint32_t orders = 0;
+        uint64_t quantity = 0;
+    };
+    MassCancel cancelOwner(uint32_t ownerId, std::vector<uint64_t>* cancelled = nullptr);
+    MassCancel cancelOwner(uint32_t ownerId, Side side, std::vector<uint64_t>* cancelled = nullptr);
+    uint32_t getOwnerOrderCount(uint32_t ownerId, Side side) const;
+
     // Market data access
     double bestBid() const;
     double bestAsk() const;
     std::vector<LevelInfo> getTopLevels(Side side, size_t depth) const;
     
+    // Top levels published for lock-free readers. Off by default; when enabled, any
+    // order or cancel that changes the best SNAPSHOT_DEPTH levels of a side republishes
+    // both sides before returning, and getTopLevels with depth <= SNAPSHOT_DEPTH is
+    // served from the snapshot without taking the lock. May be toggled while readers
+    // run: the snapshot storage, once allocated, lives as long as the book, and
+    // disabling only stops publication (readers fall back to the locked walk).
+    static constexpr size_t SNAPSHOT_DEPTH = 10;
+    struct DepthSnapshot {
+        uint64_t version = 0;   // Bumped on every publication
+        uint32_t bidLevels = 0;
+        uint32_t askLevels = 0;
+        std::array<LevelInfo, SNAPSHOT_DEPTH> bids{};   // Best first
+        std::array<LevelInfo, SNAPSHOT_DEPTH> asks{};
+    };
+    void setDepthSnapshotEnabled(bool enabled);
+    bool depthSnapshotEnabled() const { return depth_.load(std::memory_order_acquire) != nullptr; }
+    // Consistent copy of the latest snapshot; false when snapshots are disabled
+    bool readDepthSnapshot(DepthSnapshot& out) const;
+
     // Advanced features
     uint64_t getTotalVolume(Side side) const;
     double getWeightedMidPrice() const;
     uint64_t getOrderCount() const { return orderCount_.load(); }
 
+    // Memory footprint, in bytes obtained from the upstream resource per category
+    struct MemoryUsage {
+        size_t   orderBytes  = 0;   // Resting order records
+        size_t   levelBytes  = 0;   // Price level map nodes
+        size_t   indexBytes  = 0;   // Order ID index (buckets + nodes)
+        size_t   bufferBytes = 0;   // Fixed per-book overhead (stats histograms, inline state)
+        uint64_t restingOrders = 0;
+
+        size_t totalBytes() const { return orderBytes + levelBytes + indexBytes + bufferBytes; }
+        double bytesPerOrder() const {
+            return restingOrders ? double(orderBytes + levelBytes + indexBytes) / restingOrders : 0.0;
+        }
+    };
+    MemoryUsage memoryUsage() const;
+    // Per resting order: a cold slab record plus ID, quantity and owner in its level queue
+    static constexpr size_t coldOrderBytes() { return sizeof(ColdOrder); }
+    static constexpr size_t hotOrderBytes() { return sizeof(uint64_t) + 2 * sizeof(uint32_t); }
+    std::pmr::memory_resource* upstreamResource() const { return upstream_; }
+    const ArenaResource* ownedArena() const { return ownedArena_.get(); }
+
+    // Placement requested through MemoryOptions (-1 when unset)
+    int numaNode() const { return numaNode_; }
+    int engineCpu() const { return engineCpu_; }
+
+    // Pins the calling thread to the book's CPU, or to any CPU of its node.
+    // Call it from the thread that will match against this book.
+    bool pinEngineThread() const;
+
+    // Arena bytes needed to hold maxOrders resting orders without spilling
+    static size_t footprintHint(size_t maxOrders);
+
+    // Runs a synthetic session (resting, amends, partial and multi-level fills, FOK,
+    // cancels, queries) to warm caches, branch predictors and internal pools before
+    // the open. Only valid on an empty book with no concurrent callers; the book,
+    // its counters and the fill handler are left as they were, and lock statistics
+    // are cleared so they start at the open. Returns false, doing nothing, if orders
+    // are resting.
+    bool warmup(size_t rounds = 2000);
+
     using FillHandler = std::function<void(const Fill&)>;
     void setFillHandler(FillHandler handler);
     
+    // Lock wait (request -> acquired) and hold (acquired -> released) times
+    struct LockSiteStats {
+        LatencyHistogram wait;
+        LatencyHistogram hold;
+    };
+
     // Performance monitoring
     struct Stats {
         std::atomic<uint64_t> ordersProcessed{0};
@@ -84,6 +216,27 @@ public:
         uint64_t getFillsGenerated() const { return fillsGenerated.load(); }
         uint64_t getAvgProcessingTimeNs() const { return avgProcessingTimeNs.load(); }
         uint64_t getPeakOrdersPerSecond() const { return peakOrdersPerSecond.load(); }
+
+        // Populated only while lock statistics are enabled. The histograms (~12 KB) are
+        // allocated the first time they are enabled, so idle books don't carry them.
+        using LockSiteArray = std::array<LockSiteStats, static_cast<size_t>(LockSite::Count)>;
+        std::atomic<LockSiteArray*> lockSites{nullptr};
+        ~Stats() { delete lockSites.load(); }
+
+        const LockSiteStats& getLockStats(LockSite site) const {
+            static const LockSiteStats none;
+            const LockSiteArray* sites = lockSites.load(std::memory_order_acquire);
+            return sites ? (*sites)[static_cast<size_t>(site)] : none;
+        }
+
+        void resetLockStats() {
+            if (LockSiteArray* sites = lockSites.load(std::memory_order_acquire)) {
+                for (auto& site : *sites) {
+                    site.wait.reset();
+                    site.hold.reset();
+                }
+            }
+        }
     };
     
     const Stats& getStats() const { return stats_; }
@@ -92,20 +245,166 @@ public:
         stats_.fillsGenerated = 0;
         stats_.avgProcessingTimeNs = 0;
         stats_.peakOrdersPerSecond = 0;
+        stats_.resetLockStats();
     }
 
+    // Lock backend (see book_lock.hpp). Exclusive is the default; SharedReaders lets
+    // queries run concurrently; SingleThreaded drops locking for a book owned by one
+    // thread. Switch modes only while no other thread is using the book.
+    void setConcurrencyMode(ConcurrencyMode mode);
+    ConcurrencyMode concurrencyMode() const { return mutex_.mode(); }
+
+    // Lock contention instrumentation (off by default; costs two clock reads per acquisition)
+    void setLockStatsEnabled(bool enabled);
+    bool lockStatsEnabled() const { return lockStatsEnabled_.load(std::memory_order_relaxed); }
+
 private:
+    // Cold per-order data lives in a slab of fixed-size chunks addressed by 32-bit handles.
+    // Books sized for few orders use small chunks so an idle book stays a few KB.
+    static constexpr uint32_t ORDER_CHUNK_SHIFT = 12;         // 4096 records, 80 KB
+    static constexpr uint32_t SMALL_ORDER_CHUNK_SHIFT = 8;    // 256 records, 5 KB
+    static constexpr size_t SMALL_BOOK_ORDERS = 65536;
+    uint32_t orderChunkSize() const { return 1u << orderChunkShift_; }
+
+    // Fields the matching loop never reads. The hot fields (ID, quantity, owner)
+    // sit contiguously in the level's LevelQueue; side and price are per level.
+    struct ColdOrder {
+        uint32_t level;             // Handle of the owning PriceLevel
+        uint32_t position;          // Absolute position in the level queue
+        uint32_t flags       : 4;   // OrderType (bit 0), TimeInForce (bits 1-2)
+        uint32_t timestampMs : 28;  // Milliseconds since book construction (wraps after ~74h)
+        uint32_t prevOfOwner;       // Links in the owner's list for this side (NO_ORDER at the ends)
+        uint32_t nextOfOwner;
+    };
+    static_assert(sizeof(ColdOrder) == 20, "ColdOrder must stay at 20 bytes");
+    static constexpr uint32_t NO_ORDER = UINT32_MAX;
+
+    struct PriceLevel {
+        LevelQueue queue;
+        int64_t    priceTick = 0;
+        Side       side = Side::Buy;
+
+        explicit PriceLevel(std::pmr::memory_resource* mr) : queue(mr) {}
+        bool empty() const { return queue.empty(); }
+    };
+
+    using LevelMap = std::pmr::map<int64_t, uint32_t>;           // price -> level handle
+    using OrderIndex = std::pmr::unordered_map<uint64_t, uint32_t>;  // id -> cold order handle
+    using OwnerIndex = std::pmr::unordered_map<uint64_t, uint32_t>;  // (owner, side) -> newest order handle
+
+    ColdOrder& cold(uint32_t handle) {
+        return orderChunks_[handle >> orderChunkShift_][handle & (orderChunkSize() - 1)];
+    }
+    const ColdOrder& cold(uint32_t handle) const {
+        return orderChunks_[handle >> orderChunkShift_][handle & (orderChunkSize() - 1)];
+    }
+
+    LockSiteStats* lockSite(LockSite site) const {
+        if (!lockStatsEnabled_.load(std::memory_order_relaxed)) return nullptr;
+        Stats::LockSiteArray* sites = stats_.lockSites.load(std::memory_order_acquire);
+        return sites ? &(*sites)[static_cast<size_t>(site)] : nullptr;
+    }
+
+    // Levels that empty stay in the price map (so a flickering touch price reuses its
+    // node and buffer) until a side accumulates more than this many, then get compacted
+    static constexpr uint32_t MAX_EMPTY_LEVELS = 64;
+
+    static size_t sideIndex(Side side) { return static_cast<size_t>(side); }
+    const PriceLevel* bestLevel(Side side) const;
+    void levelEmptied(Side side) { ++emptyLevels_[sideIndex(side)]; }
+    void compactLevels(Side side);
+    void maybeCompactLevels(Side side) {
+        if (emptyLevels_[sideIndex(side)] > MAX_EMPTY_LEVELS) compactLevels(side);
+    }
+
+    uint32_t allocateOrder();
+    void releaseOrder(uint32_t handle);
+    uint32_t acquireLevel(int64_t priceTick, Side side);
+    void releaseLevel(uint32_t handle);
+    void retireOrder(uint64_t orderId, uint32_t ownerId, Side side);
+    static uint64_t ownerKey(uint32_t ownerId, Side side) { return uint64_t(ownerId) << 1 | sideIndex(side); }
+    void linkOwner(uint32_t handle, uint32_t ownerId, Side side);
+    void unlinkOwner(uint32_t handle, uint32_t ownerId, Side side);
+    void cancelOwnerSide(uint32_t ownerId, Side side, MassCancel& result, std::vector<uint64_t>* cancelled);
+    uint64_t levelQuantity(const PriceLevel& level) const;
+    bool levelCovers(const PriceLevel& level, uint32_t excludeOwner, uint32_t& needed) const;
+    Order toOrder(uint32_t handle) const;
+
+    // Matching-path prefetch (level boundaries only: reaching a resting order's cold
+    // record takes an index lookup, which a prefetch cannot hide)
+    void prefetchLevelHead(uint32_t handle) const;
+    template<typename Iterator>
+    void prefetchAhead(Iterator next, Iterator end, int64_t limitTick, bool ascending) const;
+
+    // Writer-side state for the published depth snapshot
+    struct DepthState {
+        SnapshotBuffer<DepthSnapshot> buffer;
+        std::array<int64_t, 2> visibleBound{INT64_MIN, INT64_MAX};   // Worst published price per side
+        uint64_t version = 0;
+        bool dirty = true;
+    };
+    size_t collectLevels(Side side, LevelInfo* out, size_t depth) const;
+    void publishDepth(DepthState& depth);
+    // Writer side, under the lock: the only thread that changes depth_
+    DepthState* depthState() const { return depth_.load(std::memory_order_relaxed); }
+    void markDepthDirty() { if (DepthState* depth = depthState()) depth->dirty = true; }
+    void noteDepthChange(Side side, int64_t priceTick) {
+        DepthState* depth = depthState();
+        if (!depth) return;
+        if (side == Side::Buy ? priceTick >= depth->visibleBound[0] : priceTick <= depth->visibleBound[1]) {
+            depth->dirty = true;
+        }
+    }
+    void maybePublishDepth() {
+        DepthState* depth = depthState();
+        if (depth && depth->dirty) publishDepth(*depth);
+    }
+
     bool canFullyFill(const Order& order) const;
     void matchLoop(const Order& order, uint32_t& remaining, std::vector<Fill>* fills);
     void restOrder(const Order& order, uint32_t remaining);
 
-    // Primary mutex for thread safety
-    mutable std::mutex mutex_;
+    // Primary mutex for thread safety (see book_lock.hpp for the reader-writer mode)
+    mutable BookMutex mutex_;
+
+    OrderBook(size_t maxOrders, std::pmr::memory_resource* upstream, std::unique_ptr<ArenaResource> arena);
+
+    int numaNode_ = -1;
+    int engineCpu_ = -1;
+    std::unique_ptr<ArenaResource> ownedArena_;   // Set when constructed with MemoryOptions
+    std::pmr::memory_resource* upstream_;
+
+    // Per-category byte counters sitting between each pool and the upstream resource
+    CountingResource orderBytes_;
+    CountingResource levelBytes_;
+    CountingResource indexBytes_;
+
+    // Pools recycle freed nodes so steady-state matching never hits the heap.
+    // Level queue buffers can grow large, so their pool serves blocks up to 1 MB.
+    std::pmr::unsynchronized_pool_resource queuePool_{{0, 1 << 20}, &orderBytes_};
+    std::pmr::unsynchronized_pool_resource levelPool_{&levelBytes_};
+    std::pmr::unsynchronized_pool_resource indexPool_{&indexBytes_};
+
+    // Cold order slab; freed handles are recycled LIFO
+    std::pmr::vector<ColdOrder*> orderChunks_{&orderBytes_};
+    uint32_t orderChunkShift_;
+    std::pmr::vector<uint32_t> freeOrders_{&orderBytes_};
+    uint32_t orderSlots_ = 0;       // Handles handed out so far (high-water mark)
+
+    // Price level slab; handles stay valid as it grows and queue buffers are kept on release
+    std::pmr::vector<PriceLevel> levels_{&levelPool_};
+    std::pmr::vector<uint32_t> freeLevels_{&levelPool_};
 
     // Price levels ordered by price (map provides O(log N) access)
-    std::map<int64_t, std::deque<Order*>> bids_;  // Descending by price
-    std::map<int64_t, std::deque<Order*>> asks_;  // Ascending by price
-    std::unordered_map<uint64_t, Order> orders_;  // Fast order lookup by ID
+    LevelMap bids_{&levelPool_};   // Descending by price
+    LevelMap asks_{&levelPool_};   // Ascending by price
+    OrderIndex orders_{&indexPool_};  // Fast order lookup by ID
+    OwnerIndex owners_{&indexPool_};  // Heads of the per-owner, per-side order lists (kept once empty)
+    std::array<uint32_t, 2> emptyLevels_{};   // Retained empty levels per side
+    // Allocated on first enable and kept until destruction, so a reader that loaded
+    // depth_ just before a disable still reads valid (if stale) memory
+    std::unique_ptr<DepthState> depthStorage_;
+    std::atomic<DepthState*> depth_{nullptr};   // depthStorage_ while snapshots are enabled
 
     // Lock-free counters for low-latency queries
     std::atomic<uint64_t> orderCount_{0};
@@ -113,8 +412,11 @@ private:
     std::atomic<int64_t> bestAskTick_{INT64_MAX};
 
     mutable Stats stats_;
+    std::atomic<bool> lockStatsEnabled_{false};
     FillHandler fillCb_;
 
+    uint64_t epochNs_;   // Reference point for compact resting timestamps
+
     uint64_t getCurrentTimeNs() const;
 };
 
@@ -129,7 +431,25 @@ namespace HFTUtils {
     #define UNLIKELY(x) (x)
 #endif
 
+    // Software prefetch hints on the matching path (opt-in: make PREFETCH=1 ...)
+#if defined(ORDERBOOK_PREFETCH) && (defined(__GNUC__) || defined(__clang__))
+    #define PREFETCH(addr) __builtin_prefetch((addr), 1, 3)
+    inline constexpr bool prefetchEnabled = true;
+#else
+    #define PREFETCH(addr) ((void)(addr))
+    inline constexpr bool prefetchEnabled = false;
+#endif
+
     inline void memoryBarrier() {
         std::atomic_thread_fence(std::memory_order_acq_rel);
     }
+
+    // Spin-wait hint for polling loops (frees pipeline resources for the sibling hyperthread)
+    inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
 }
\ No newline at end of file
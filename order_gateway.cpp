@@ -0,0 +1,415 @@
+#include "order_gateway.hpp"
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace {
+    bool parseUnsigned(std::string_view value, uint64_t& out) {
+        if (value.empty() || value.size() > 19) return false;
+        uint64_t result = 0;
+        for (char c : value) {
+            if (c < '0' || c > '9') return false;
+            result = result * 10 + uint64_t(c - '0');
+        }
+        out = result;
+        return true;
+    }
+
+    // Decimal price to ticks; more decimal places than a tick resolves is malformed
+    bool parsePrice(std::string_view value, int64_t& ticks) {
+        size_t dot = value.find('.');
+        uint64_t whole = 0, fraction = 0;
+        if (!parseUnsigned(value.substr(0, dot), whole)) return false;
+        int64_t scale = TICK_PRECISION;
+        if (dot != std::string_view::npos) {
+            std::string_view digits = value.substr(dot + 1);
+            if (digits.empty()) return false;
+            for (char c : digits) {
+                scale /= 10;
+                if (scale == 0 || c < '0' || c > '9') return false;
+                fraction += uint64_t(c - '0') * uint64_t(scale);
+            }
+        }
+        if (whole > uint64_t(std::numeric_limits<int64_t>::max() / TICK_PRECISION)) return false;
+        ticks = int64_t(whole) * TICK_PRECISION + int64_t(fraction);
+        return true;
+    }
+
+    constexpr bool isSeparator(char c) { return c == '|' || c == '\x01'; }
+
+    // Value of tag 35, found without decoding the rest (0 if absent or repeated;
+    // the validator rejects a repeated tag 35, so it must not pass as a cancel here)
+    char messageTypeOf(std::string_view text) {
+        char type = 0;
+        bool seen = false;
+        size_t pos = 0;
+        while (pos < text.size()) {
+            if (text.substr(pos, 3) == "35=") {
+                if (seen) return 0;
+                seen = true;
+                type = pos + 3 < text.size() ? text[pos + 3] : 0;
+            }
+            while (pos < text.size() && !isSeparator(text[pos])) ++pos;
+            ++pos;
+        }
+        return type;
+    }
+
+    std::vector<RateLimit> rateLimitsOf(const GatewayRules& rules) {
+        std::vector<RateLimit> limits;
+        limits.reserve(rules.ownerLimits.size());
+        for (const OwnerLimits& owner : rules.ownerLimits) limits.push_back(owner.rate);
+        return limits;
+    }
+
+    uint64_t steadyNowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+}
+
+const char* rejectReasonName(RejectReason reason) {
+    switch (reason) {
+        case RejectReason::None:              return "none";
+        case RejectReason::Malformed:         return "malformed";
+        case RejectReason::UnknownInstrument: return "unknown instrument";
+        case RejectReason::PriceBand:         return "price band";
+        case RejectReason::LotSize:           return "lot size";
+        case RejectReason::MaxQuantity:       return "max quantity";
+        case RejectReason::NotPermitted:      return "not permitted";
+        case RejectReason::DuplicateId:       return "duplicate id";
+        case RejectReason::Overloaded:        return "overloaded";
+        case RejectReason::RateLimited:       return "rate limited";
+        default:                              return "unknown";
+    }
+}
+
+const char* overloadPolicyName(OverloadPolicy policy) {
+    switch (policy) {
+        case OverloadPolicy::Reject:         return "reject";
+        case OverloadPolicy::ShedByPriority: return "shed by priority";
+        case OverloadPolicy::Block:          return "block";
+    }
+    return "unknown";
+}
+
+bool GatewayMessage::assign(uint32_t sessionOwner, std::string_view message) {
+    if (message.size() > MAX_LENGTH) return false;
+    owner = sessionOwner;
+    length = static_cast<uint16_t>(message.size());
+    std::memcpy(text, message.data(), message.size());
+    return true;
+}
+
+RejectReason OrderValidator::check(const GatewayMessage& message, EngineCommand& command) {
+    char msgType = 0;
+    uint64_t id = 0, instrument = 0, quantity = 0, account = 0;
+    int64_t priceTick = 0;
+    bool hasId = false, hasInstrument = false, hasPrice = false, hasQuantity = false, hasAccount = false;
+    Side side = Side::Buy;
+    bool hasSide = false;
+    OrderType type = OrderType::Limit;
+    TimeInForce tif = TimeInForce::GTC;
+
+    command = EngineCommand{};
+    std::string_view text = message.view();
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = pos;
+        while (end < text.size() && !isSeparator(text[end])) ++end;
+        std::string_view field = text.substr(pos, end - pos);
+        pos = end + 1;
+        if (field.empty()) continue;
+
+        size_t eq = field.find('=');
+        uint64_t tag = 0;
+        if (eq == std::string_view::npos || !parseUnsigned(field.substr(0, eq), tag)) return RejectReason::Malformed;
+        std::string_view value = field.substr(eq + 1);
+
+        bool ok = true;
+        switch (tag) {
+            case 35: ok = value.size() == 1 && msgType == 0; msgType = ok ? value[0] : 0; break;   // Exactly once
+            case 11: ok = hasId = parseUnsigned(value, id); command.order.id = id; break;
+            case 55: ok = hasInstrument = parseUnsigned(value, instrument); break;
+            case 54:
+                ok = hasSide = value == "1" || value == "2";
+                side = value == "2" ? Side::Sell : Side::Buy;
+                break;
+            case 44: ok = hasPrice = parsePrice(value, priceTick); break;
+            case 38: ok = hasQuantity = parseUnsigned(value, quantity) && quantity <= UINT32_MAX; break;
+            case 40:
+                ok = value == "1" || value == "2";
+                type = value == "1" ? OrderType::Market : OrderType::Limit;
+                break;
+            case 59:
+                if (value == "0") tif = TimeInForce::GFD;
+                else if (value == "1") tif = TimeInForce::GTC;
+                else if (value == "3") tif = TimeInForce::IOC;
+                else if (value == "4") tif = TimeInForce::FOK;
+                else ok = false;
+                break;
+            case 1: ok = hasAccount = parseUnsigned(value, account); break;
+            default: break;   // Fields the engine doesn't use
+        }
+        if (!ok) return RejectReason::Malformed;
+    }
+
+    if (!hasId || id == 0) return RejectReason::Malformed;
+
+    // Owner: the session's, and the message may not claim another
+    const uint32_t owner = message.owner;
+    if (hasAccount && account != owner) return RejectReason::NotPermitted;
+    if (!rules_.permittedOwners.empty() &&
+        (owner >= rules_.permittedOwners.size() || !rules_.permittedOwners[owner])) {
+        return RejectReason::NotPermitted;
+    }
+
+    if (hasInstrument && instrument >= rules_.maxInstruments) return RejectReason::UnknownInstrument;
+    command.instrument = static_cast<InstrumentId>(instrument);
+    command.order.ownerId = owner;
+
+    switch (msgType) {
+        case 'D': {
+            if (!hasInstrument || !hasSide || !hasQuantity || (type == OrderType::Limit && !hasPrice)) {
+                return RejectReason::Malformed;
+            }
+            command.type = CommandType::Submit;
+            command.order = {id, side, type == OrderType::Limit ? priceTick : 0, uint32_t(quantity), type, tif, owner, 0};
+            if (RejectReason reason = checkOrder(command.order, command.instrument); reason != RejectReason::None) {
+                return reason;
+            }
+            // IDs from an owner must increase; only accepted orders move the mark
+            auto [it, inserted] = lastOrderId_.try_emplace(owner, id);
+            if (!inserted) {
+                if (id <= it->second) return RejectReason::DuplicateId;
+                it->second = id;
+            }
+            return RejectReason::None;
+        }
+        case 'F':
+            command.type = CommandType::Cancel;
+            return RejectReason::None;
+        case 'G': {
+            if (!hasInstrument || !hasPrice || !hasQuantity) return RejectReason::Malformed;
+            command.type = CommandType::Modify;
+            command.order.priceTick = priceTick;
+            command.order.quantity = uint32_t(quantity);
+            return checkOrder(command.order, command.instrument);
+        }
+        default:
+            return RejectReason::Malformed;
+    }
+}
+
+RejectReason OrderValidator::checkOrder(const Order& order, InstrumentId instrument) const {
+    static const InstrumentRules defaults;
+    const InstrumentRules& rules = instrument < rules_.instruments.size() ? rules_.instruments[instrument] : defaults;
+    if (order.quantity == 0) return RejectReason::Malformed;
+    if (order.type == OrderType::Limit &&
+        (order.priceTick < rules.minPriceTick || order.priceTick > rules.maxPriceTick)) {
+        return RejectReason::PriceBand;
+    }
+    if (rules.lotSize > 1 && order.quantity % rules.lotSize != 0) return RejectReason::LotSize;
+    if (order.quantity > rules.maxQuantity) return RejectReason::MaxQuantity;
+    return RejectReason::None;
+}
+
+OrderGateway::OrderGateway(const GatewayRules& rules, const Options& options,
+                           FillHandler onFill, RejectHandler onReject)
+    : rules_(rules), options_(options), rateLimiter_(rateLimitsOf(rules)),
+      fillCb_(std::move(onFill)), rejectCb_(std::move(onReject)),
+      sequencer_(options.sequencerCapacity), books_(rules.maxInstruments, options.ordersPerBookHint) {
+    // Only the matching thread touches the books
+    books_.setBookConcurrencyMode(ConcurrencyMode::SingleThreaded);
+    fills_.reserve(256);
+
+    EngineRunner::Options matcher;
+    matcher.cpu = options_.matcherCpu;
+    matcher.idle = options_.idle;
+    matcher_ = std::make_unique<EngineRunner>(matcher, [this] { return pollMatcher(); },
+                                              [this] { return sequencer_.sizeApprox(); });
+
+    unsigned count = std::max(1u, options_.gateways);
+    gateways_.reserve(count);
+    double limit = std::clamp(options_.overloadThreshold, 0.0, 1.0) * double(options_.gatewayQueueCapacity);
+    for (uint8_t priority = 0; priority < OWNER_PRIORITIES; ++priority) {
+        double share = options_.overload == OverloadPolicy::ShedByPriority
+                           ? double(priority + 1) / OWNER_PRIORITIES : 1.0;
+        shedDepth_[priority] = std::max<size_t>(1, size_t(limit * share));
+    }
+    for (unsigned i = 0; i < count; ++i) {
+        gateways_.push_back(std::make_unique<Gateway>(rules_, options_.gatewayQueueCapacity));
+    }
+    for (unsigned i = 0; i < count; ++i) {
+        Gateway* gateway = gateways_[i].get();
+        EngineRunner::Options runner;
+        runner.cpu = options_.gatewayCpus.empty() ? -1 : options_.gatewayCpus[i % options_.gatewayCpus.size()];
+        runner.idle = options_.idle;
+        gateway->runner = std::make_unique<EngineRunner>(runner, [this, gateway] { return pollGateway(*gateway); },
+                                                         [gateway] { return gateway->inbound.sizeApprox(); });
+    }
+}
+
+OrderGateway::~OrderGateway() {
+    stop();
+}
+
+bool OrderGateway::receive(uint32_t owner, std::string_view message, RejectReason* refused) {
+    if (refused) *refused = RejectReason::None;
+    if (!running_.load(std::memory_order_relaxed)) return false;
+    GatewayMessage raw;
+    if (!raw.assign(owner, message)) {
+        if (refused) *refused = RejectReason::Malformed;
+        return false;
+    }
+    Gateway& gateway = *gateways_[gatewayOf(owner)];
+    uint64_t now = (options_.measureLatency || rateLimiter_.limited(owner)) ? steadyNowNs() : 0;
+    char messageType = messageTypeOf(message);
+    RejectReason reason = admit(gateway, owner, messageType, now);
+    if (reason == RejectReason::None) {
+        raw.receivedNs = now;
+        if (gateway.inbound.tryPush(raw)) return true;
+        gateway.queueFull.fetch_add(1, std::memory_order_relaxed);
+        if (options_.overload == OverloadPolicy::Block) {
+            while (!gateway.inbound.tryPush(raw)) {
+                if (!running_.load(std::memory_order_relaxed)) return false;
+                std::this_thread::yield();
+            }
+            return true;
+        }
+        // Refused after all: the message doesn't cost the owner a token
+        if (messageType != 'F') rateLimiter_.release(owner);
+        gateway.overloaded.fetch_add(1, std::memory_order_relaxed);
+        reason = RejectReason::Overloaded;
+    }
+    if (refused) *refused = reason;
+    return false;
+}
+
+// Cancels always get in (while there is room); new orders and amends pass the
+// overload threshold for the owner's priority, then take a token from the owner's
+// rate limit (so a message refused as overloaded costs none)
+RejectReason OrderGateway::admit(Gateway& gateway, uint32_t owner, char messageType, uint64_t nowNs) {
+    if (messageType == 'F') return RejectReason::None;
+    if (options_.overload != OverloadPolicy::Block &&
+        gateway.inbound.sizeApprox() >= shedDepth_[priorityOf(owner)]) {
+        gateway.overloaded.fetch_add(1, std::memory_order_relaxed);
+        return RejectReason::Overloaded;
+    }
+    if (!rateLimiter_.tryAcquire(owner, nowNs)) {
+        gateway.rateLimited.fetch_add(1, std::memory_order_relaxed);
+        return RejectReason::RateLimited;
+    }
+    return RejectReason::None;
+}
+
+uint8_t OrderGateway::priorityOf(uint32_t owner) const {
+    if (owner >= rules_.ownerLimits.size()) return 0;
+    return std::min<uint8_t>(rules_.ownerLimits[owner].priority, OWNER_PRIORITIES - 1);
+}
+
+size_t OrderGateway::pollGateway(Gateway& gateway) {
+    uint32_t batch = 0;
+    GatewayMessage message;
+    EngineCommand command;
+    while (batch < DRAIN_BATCH && gateway.inbound.tryPop(message)) {
+        RejectReason reason = gateway.validator.check(message, command);
+        if (reason == RejectReason::None) {
+            command.enqueuedNs = message.receivedNs;
+            // The matcher is the bottleneck by design; wait for it rather than drop
+            if (!sequencer_.tryPush(command)) {
+                gateway.sequencerFull.fetch_add(1, std::memory_order_relaxed);
+                while (!sequencer_.tryPush(command)) std::this_thread::yield();
+            }
+            gateway.forwarded.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            gateway.rejects[size_t(reason)].fetch_add(1, std::memory_order_relaxed);
+            if (rejectCb_) rejectCb_(message.owner, command.order.id, reason);
+        }
+        ++batch;
+    }
+    if (batch > 0) gateway.processed.fetch_add(batch, std::memory_order_release);
+    return batch;
+}
+
+size_t OrderGateway::pollMatcher() {
+    uint32_t batch = 0;
+    EngineCommand command;
+    while (batch < DRAIN_BATCH && sequencer_.tryPop(command)) {
+        ++batch;
+        if (!ownsTarget(command)) {
+            ++notPermittedLocal_;
+            notPermitted_.store(notPermittedLocal_, std::memory_order_relaxed);
+            if (rejectCb_) rejectCb_(command.order.ownerId, command.order.id, RejectReason::NotPermitted);
+            continue;
+        }
+        if (!applyCommand(books_, command, fills_)) ++bookRejectedLocal_;
+        if (options_.measureLatency) {
+            latency_[priorityOf(command.order.ownerId)].record(steadyNowNs() - command.enqueuedNs);
+        }
+        fillLocal_ += fills_.size();
+        if (fillCb_) {
+            for (const Fill& fill : fills_) fillCb_(command.instrument, fill);
+        }
+    }
+    if (batch > 0) {
+        matchedLocal_ += batch;
+        bookRejected_.store(bookRejectedLocal_, std::memory_order_relaxed);
+        fillCount_.store(fillLocal_, std::memory_order_relaxed);
+        matched_.store(matchedLocal_, std::memory_order_release);
+    }
+    return batch;
+}
+
+// Cancels and amends of an order resting under another owner are refused. Unknown
+// orders go on to the book, which rejects them.
+bool OrderGateway::ownsTarget(const EngineCommand& command) const {
+    if (command.type == CommandType::Submit) return true;
+    int64_t owner = books_.ownerOf(command.order.id);
+    return owner < 0 || uint32_t(owner) == command.order.ownerId;
+}
+
+void OrderGateway::waitIdle() const {
+    // Gateways first: once they have processed everything, every forwarded command is in the sequencer
+    for (const auto& gateway : gateways_) {
+        uint64_t target = gateway->inbound.pushed();
+        while (gateway->processed.load(std::memory_order_acquire) < target) std::this_thread::yield();
+    }
+    uint64_t target = sequencer_.pushed();
+    while (matched_.load(std::memory_order_acquire) < target) std::this_thread::yield();
+}
+
+void OrderGateway::stop() {
+    running_.store(false, std::memory_order_release);
+    for (auto& gateway : gateways_) {
+        if (gateway->runner) gateway->runner->stop();
+    }
+    if (matcher_) matcher_->stop();
+}
+
+OrderGateway::Stats OrderGateway::stats() const {
+    Stats stats;
+    for (const auto& gateway : gateways_) {
+        stats.received += gateway->processed.load(std::memory_order_acquire);
+        stats.forwarded += gateway->forwarded.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < stats.rejects.size(); ++i) {
+            stats.rejects[i] += gateway->rejects[i].load(std::memory_order_relaxed);
+        }
+        stats.rejects[size_t(RejectReason::Overloaded)] += gateway->overloaded.load(std::memory_order_relaxed);
+        stats.rejects[size_t(RejectReason::RateLimited)] += gateway->rateLimited.load(std::memory_order_relaxed);
+        stats.gatewayQueueFull += gateway->queueFull.load(std::memory_order_relaxed);
+        stats.sequencerFull += gateway->sequencerFull.load(std::memory_order_relaxed);
+        if (gateway->runner) stats.gateways.push_back(gateway->runner->stats());
+    }
+    stats.matched = matched_.load(std::memory_order_acquire);
+    stats.bookRejected = bookRejected_.load(std::memory_order_relaxed);
+    stats.fills = fillCount_.load(std::memory_order_relaxed);
+    stats.rejects[size_t(RejectReason::NotPermitted)] += notPermitted_.load(std::memory_order_relaxed);
+    if (matcher_) stats.matcher = matcher_->stats();
+    return stats;
+}
+
+void OrderGateway::matchLatency(uint8_t priority, LatencyHistogram& out) const {
+    if (priority < OWNER_PRIORITIES) out.merge(latency_[priority]);
+}
@@ -0,0 +1,241 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "book_manager.hpp"
+#include "command_queue.hpp"
+#include "engine_runner.hpp"
+#include "latency_histogram.hpp"
+#include "rate_limiter.hpp"
+#include "sharded_engine.hpp"
+
+// Staged order entry: decode and validate in parallel, match on one thread.
+//
+//   client sessions --> gateway threads (decode, validate) --> sequencer queue --> matching thread
+//
+// Each gateway thread owns a slice of the owners (owner % gateways), so per-owner
+// state needs no locking, and everything that can reject an order without looking
+// at the book happens there: message decoding, price band, lot size, maximum
+// quantity, owner permissions and duplicate order IDs. Only commands that passed
+// are sequenced into the matching thread, which does nothing but apply them to
+// its books.
+//
+// Cancels and amends may only target the sender's own orders. Which owner an
+// order belongs to is known only where the books are, so the matching thread
+// checks it before applying them and refuses a mismatch as NotPermitted.
+//
+// Duplicate detection is per owner: each owner's order IDs must increase, and an
+// ID at or below the owner's high-water mark is rejected as a duplicate (replayed
+// or resent message). The book still refuses IDs that are resting anywhere.
+//
+// Overload is handled at the door. Every queue is bounded. When the matcher
+// falls behind, the sequencer fills, then gateways wait on it and their inbound
+// queues fill. receive() then applies the overload policy, so a flood is refused
+// up front rather than queued as unbounded latency for everyone. Per-owner token
+// buckets cap each owner's message rate before anything is queued. Cancels are
+// exempt from both the rate limit and the overload thresholds, so an owner can
+// always pull its orders while there is room in the queue.
+
+enum class RejectReason : uint8_t {
+    None,
+    Malformed,            // Missing or unparsable field, unknown message type
+    UnknownInstrument,
+    PriceBand,            // Outside the instrument's allowed price range
+    LotSize,              // Quantity not a multiple of the lot size
+    MaxQuantity,
+    NotPermitted,         // Owner blocked, or the message names a different owner
+    DuplicateId,          // Order ID not above the owner's last one
+    Overloaded,           // Refused by the overload policy in receive()
+    RateLimited,          // Owner's token bucket was empty
+    Count
+};
+
+const char* rejectReasonName(RejectReason reason);
+
+struct InstrumentRules {
+    int64_t  minPriceTick = 1;
+    int64_t  maxPriceTick = std::numeric_limits<int64_t>::max();
+    uint32_t lotSize = 1;
+    uint32_t maxQuantity = std::numeric_limits<uint32_t>::max();
+};
+
+struct OwnerLimits {
+    uint8_t   priority = 0;       // 0 (shed first) to OWNER_PRIORITIES - 1, for ShedByPriority
+    RateLimit rate;               // New orders and amends; unlimited by default
+};
+
+inline constexpr uint8_t OWNER_PRIORITIES = 4;
+
+struct GatewayRules {
+    std::vector<InstrumentRules> instruments;   // Indexed by instrument; missing entries use defaults
+    std::vector<uint8_t> permittedOwners;       // Indexed by owner, nonzero = may trade; empty = all
+    std::vector<OwnerLimits> ownerLimits;       // Indexed by owner; missing entries use defaults
+    size_t maxInstruments = 1024;
+};
+
+// Raw message as received from a session. Tag=value fields separated by '|' or SOH:
+//   35=D|11=<order id>|55=<instrument>|54=<1 buy, 2 sell>|44=<price>|38=<qty>[|40=<1 market, 2 limit>][|59=<0 day, 1 GTC, 3 IOC, 4 FOK>][|1=<owner>]
+//   35=F|11=<order id>|55=<instrument>                      (cancel)
+//   35=G|11=<order id>|55=<instrument>|44=<price>|38=<qty>  (amend)
+// Prices are decimal with at most two places (see TICK_PRECISION).
+struct GatewayMessage {
+    static constexpr size_t MAX_LENGTH = 114;
+
+    uint32_t owner = 0;            // Session's authenticated owner
+    uint16_t length = 0;
+    char     text[MAX_LENGTH];
+    uint64_t receivedNs = 0;       // Set by receive() when measuring latency
+
+    // False if the text does not fit
+    bool assign(uint32_t sessionOwner, std::string_view message);
+    std::string_view view() const { return {text, length}; }
+};
+
+// Decode + validation for one gateway thread (per-owner state is not shared)
+class OrderValidator {
+public:
+    explicit OrderValidator(const GatewayRules& rules) : rules_(rules) {}
+
+    // Fills `command` and returns None if the message may go to the matching thread
+    RejectReason check(const GatewayMessage& message, EngineCommand& command);
+
+private:
+    RejectReason checkOrder(const Order& order, InstrumentId instrument) const;
+
+    const GatewayRules& rules_;
+    std::unordered_map<uint32_t, uint64_t> lastOrderId_;   // Per-owner high-water mark
+};
+
+// What receive() does with a new order or amend when the owner's gateway is backed up
+enum class OverloadPolicy : uint8_t {
+    Reject,            // Refuse it once the queue is past overloadThreshold
+    ShedByPriority,    // Per-priority thresholds: priority p is refused past (p + 1) / OWNER_PRIORITIES of it
+    Block              // Wait for space (the caller absorbs the backpressure)
+};
+
+const char* overloadPolicyName(OverloadPolicy policy);
+
+class OrderGateway {
+public:
+    struct Options {
+        unsigned gateways = 2;
+        size_t gatewayQueueCapacity = 1 << 14;    // Raw messages per gateway thread
+        size_t sequencerCapacity = 1 << 16;       // Validated commands waiting for the matcher
+        size_t ordersPerBookHint = 0;
+        int matcherCpu = -1;
+        std::vector<int> gatewayCpus;             // Gateway i runs on gatewayCpus[i % size]; empty: unpinned
+        IdleOptions idle;
+        OverloadPolicy overload = OverloadPolicy::Reject;
+        double overloadThreshold = 1.0;           // Share of gatewayQueueCapacity
+        bool measureLatency = false;              // Record receive-to-match time per owner priority
+    };
+
+    using FillHandler = ShardedEngine::FillHandler;                                      // Matching thread
+    // Gateway threads; the matching thread for cancels/amends of another owner's order
+    using RejectHandler = std::function<void(uint32_t owner, uint64_t orderId, RejectReason)>;
+
+    OrderGateway(const GatewayRules& rules, const Options& options,
+                 FillHandler onFill = nullptr, RejectHandler onReject = nullptr);
+    ~OrderGateway();
+
+    OrderGateway(const OrderGateway&) = delete;
+    OrderGateway& operator=(const OrderGateway&) = delete;
+
+    // Any thread. Hands a raw message to the owner's gateway. Returns false if it was
+    // refused, and sets `refused` (if given) to why: Malformed (too long), RateLimited,
+    // Overloaded (policy threshold or full queue), or None once the gateway has stopped.
+    // Messages from one owner are processed in the order they were received from a
+    // given thread.
+    bool receive(uint32_t owner, std::string_view message, RejectReason* refused = nullptr);
+
+    unsigned gatewayOf(uint32_t owner) const { return owner % static_cast<unsigned>(gateways_.size()); }
+
+    // Blocks until every message received so far has been validated and applied
+    void waitIdle() const;
+
+    // Drains the gateways, then the matcher, and joins all threads
+    void stop();
+
+    struct Stats {
+        uint64_t received = 0;                   // Messages the gateways have processed
+        uint64_t forwarded = 0;                  // Passed validation
+        std::array<uint64_t, size_t(RejectReason::Count)> rejects{};   // Including receive()'s Overloaded and RateLimited
+        uint64_t gatewayQueueFull = 0;           // receive() calls that found the queue full (refused or, under Block, waited)
+        uint64_t sequencerFull = 0;              // Times a gateway waited for the matcher
+        uint64_t matched = 0;                    // Commands the matching thread has taken (applied or refused)
+        uint64_t bookRejected = 0;               // Refused by the book (unknown order, resting duplicate, FOK miss)
+        uint64_t fills = 0;
+        EngineRunner::Stats matcher;
+        std::vector<EngineRunner::Stats> gateways;
+
+        uint64_t rejected() const {
+            uint64_t total = 0;
+            for (uint64_t count : rejects) total += count;
+            return total;
+        }
+    };
+    Stats stats() const;
+
+    // Receive-to-match time of commands from owners of one priority (needs measureLatency)
+    void matchLatency(uint8_t priority, LatencyHistogram& out) const;
+
+    // The matching thread's books. Only read them while idle (after waitIdle) or stopped.
+    const BookManager& books() const { return books_; }
+
+private:
+    struct alignas(CACHE_LINE_BYTES) Gateway {
+        Gateway(const GatewayRules& rules, size_t capacity) : inbound(capacity), validator(rules) {}
+
+        CommandQueue<GatewayMessage> inbound;
+        OrderValidator validator;
+        std::unique_ptr<EngineRunner> runner;
+
+        // Written by the gateway thread
+        alignas(CACHE_LINE_BYTES) std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> forwarded{0};
+        std::array<std::atomic<uint64_t>, size_t(RejectReason::Count)> rejects{};
+        std::atomic<uint64_t> sequencerFull{0};
+
+        // Written by sessions
+        alignas(CACHE_LINE_BYTES) std::atomic<uint64_t> queueFull{0};
+        std::atomic<uint64_t> overloaded{0};
+        std::atomic<uint64_t> rateLimited{0};
+    };
+
+    size_t pollGateway(Gateway& gateway);
+    size_t pollMatcher();
+    bool ownsTarget(const EngineCommand& command) const;
+    RejectReason admit(Gateway& gateway, uint32_t owner, char messageType, uint64_t nowNs);
+    uint8_t priorityOf(uint32_t owner) const;
+
+    static constexpr uint32_t DRAIN_BATCH = 64;
+
+    GatewayRules rules_;
+    Options options_;
+    OwnerRateLimiter rateLimiter_;
+    std::array<size_t, OWNER_PRIORITIES> shedDepth_;     // Queue depth at which each priority is refused
+    FillHandler fillCb_;
+    RejectHandler rejectCb_;
+    std::atomic<bool> running_{true};
+
+    std::vector<std::unique_ptr<Gateway>> gateways_;
+
+    // Matching thread
+    CommandQueue<EngineCommand> sequencer_;
+    BookManager books_;
+    std::vector<Fill> fills_;
+    std::unique_ptr<EngineRunner> matcher_;
+    alignas(CACHE_LINE_BYTES) std::atomic<uint64_t> matched_{0};
+    std::atomic<uint64_t> bookRejected_{0};
+    std::atomic<uint64_t> fillCount_{0};
+    std::atomic<uint64_t> notPermitted_{0};
+    uint64_t matchedLocal_ = 0, bookRejectedLocal_ = 0, fillLocal_ = 0, notPermittedLocal_ = 0;
+    std::array<LatencyHistogram, OWNER_PRIORITIES> latency_;
+};
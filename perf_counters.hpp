@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <array>
+
+#if defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Minimal hardware performance counter reader for benchmarks.
+// Uses perf_event_open on Linux; elsewhere (or when the kernel denies access)
+// available() is false and every counter reads zero.
+
+class HardwareCounters {
+public:
+    enum Event { Cycles, Instructions, CacheMisses, BranchMisses, EventCount };
+
+    HardwareCounters() {
+#if defined(__linux__)
+        static constexpr uint64_t configs[EventCount] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+        for (int i = 0; i < EventCount; ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[i];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+#endif
+    }
+
+    ~HardwareCounters() {
+#if defined(__linux__)
+        for (int fd : fds_) {
+            if (fd >= 0) close(fd);
+        }
+#endif
+    }
+
+    HardwareCounters(const HardwareCounters&) = delete;
+    HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+    bool available() const { return fds_[CacheMisses] >= 0; }
+
+    void start() {
+#if defined(__linux__)
+        for (int fd : fds_) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    void stop() {
+#if defined(__linux__)
+        for (int i = 0; i < EventCount; ++i) {
+            if (fds_[i] < 0) continue;
+            ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t value = 0;
+            if (read(fds_[i], &value, sizeof(value)) == sizeof(value)) {
+                values_[i] += value;
+            }
+        }
+#endif
+    }
+
+    uint64_t value(Event event) const { return values_[event]; }
+
+private:
+    std::array<int, EventCount> fds_{-1, -1, -1, -1};
+    std::array<uint64_t, EventCount> values_{};
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Per-owner token buckets that any number of threads can charge without a lock.
+//
+// Each bucket is one atomic word holding the time at which it will be full again
+// (the "theoretical arrival time" form of a token bucket, GCRA). Taking a token
+// pushes that time one emission interval (1s / rate) into the future; the
+// message is refused if this would put it more than `burst` intervals ahead of
+// now. Refill needs no timer or thread: elapsed time is the refill. Admitting a
+// message costs one CAS on the owner's word.
+
+struct RateLimit {
+    uint32_t perSecond = 0;    // 0: unlimited
+    uint32_t burst = 1;        // Messages that may arrive back to back
+};
+
+class OwnerRateLimiter {
+public:
+    // limits is indexed by owner; owners past the end are unlimited
+    explicit OwnerRateLimiter(const std::vector<RateLimit>& limits) : count_(limits.size()) {
+        buckets_ = std::make_unique<Bucket[]>(count_ ? count_ : 1);
+        for (size_t owner = 0; owner < count_; ++owner) {
+            const RateLimit& limit = limits[owner];
+            if (limit.perSecond == 0) continue;
+            uint64_t interval = std::max<uint64_t>(1, 1000000000ull / limit.perSecond);
+            buckets_[owner].intervalNs = interval;
+            buckets_[owner].windowNs = interval * std::max<uint32_t>(1, limit.burst);
+        }
+    }
+
+    OwnerRateLimiter(const OwnerRateLimiter&) = delete;
+    OwnerRateLimiter& operator=(const OwnerRateLimiter&) = delete;
+
+    // Any thread. Takes a token from the owner's bucket; false if it is empty.
+    bool tryAcquire(uint32_t owner, uint64_t nowNs) {
+        if (owner >= count_) return true;
+        Bucket& bucket = buckets_[owner];
+        if (bucket.intervalNs == 0) return true;
+        uint64_t full = bucket.fullAt.load(std::memory_order_relaxed);
+        for (;;) {
+            uint64_t next = std::max(full, nowNs) + bucket.intervalNs;
+            if (next - nowNs > bucket.windowNs) return false;
+            if (bucket.fullAt.compare_exchange_weak(full, next, std::memory_order_relaxed)) return true;
+        }
+    }
+
+    // Gives back a token taken by tryAcquire (the message was refused later on)
+    void release(uint32_t owner) {
+        if (owner >= count_ || buckets_[owner].intervalNs == 0) return;
+        buckets_[owner].fullAt.fetch_sub(buckets_[owner].intervalNs, std::memory_order_relaxed);
+    }
+
+    bool limited(uint32_t owner) const { return owner < count_ && buckets_[owner].intervalNs != 0; }
+
+private:
+    struct Bucket {
+        uint64_t intervalNs = 0;               // 0: unlimited
+        uint64_t windowNs = 0;                 // burst * interval
+        std::atomic<uint64_t> fullAt{0};
+    };
+
+    std::unique_ptr<Bucket[]> buckets_;
+    size_t count_;
+};
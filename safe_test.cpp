@@ -2,15 +2,61 @@
 // Provides stable benchmarks without threading complexity
 
 #include "order_book.hpp"
+#include "book_manager.hpp"
+#include "sharded_engine.hpp"
+#include "engine_runner.hpp"
+#include "book_events.hpp"
+#include "order_gateway.hpp"
+#include "async_book.hpp"
+#include "trace.hpp"
+#include "perf_counters.hpp"
+#include "simd_kernels.hpp"
+#include "numa_placement.hpp"
 #include <iostream>
 #include <chrono>
 #include <vector>
 #include <random>
 #include <iomanip>
 #include <cstring>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <map>
+#include <deque>
+#include <unordered_map>
+#include <memory_resource>
+#include <optional>
+#include <sys/resource.h>
 
 using namespace std::chrono;
 
+// One in-flight client for the async benchmark: rest an order, then cancel it,
+// timing each co_await from suspension to resumption
+AsyncTask async_client(AsyncBook& book, uint64_t first_id, int rounds, LatencyHistogram& latency,
+                       uint64_t& overloaded, int& finished) {
+    for (int i = 0; i < rounds; ++i) {
+        uint64_t id = first_id + uint64_t(i);
+        Side side = (id & 1) ? Side::Buy : Side::Sell;
+        int64_t price = (side == Side::Buy) ? 49990 - int64_t(id % 50) : 50010 + int64_t(id % 50);
+        auto start = high_resolution_clock::now();
+        AsyncResult placed = co_await book.submit({id, side, price, 100, OrderType::Limit, TimeInForce::GTC, 1, 0});
+        if (placed.overloaded) {
+            ++overloaded;   // Refused without queueing: nothing to time
+            continue;
+        }
+        latency.record(duration_cast<nanoseconds>(high_resolution_clock::now() - start).count());
+        start = high_resolution_clock::now();
+        AsyncResult cancelled = co_await book.cancel(id);
+        if (cancelled.overloaded) {
+            ++overloaded;
+            continue;
+        }
+        latency.record(duration_cast<nanoseconds>(high_resolution_clock::now() - start).count());
+    }
+    ++finished;
+}
+
 class SafePerformanceTest {
 private:
     std::mt19937 rng_;
@@ -220,7 +266,1970 @@ public:
                   << level2_time/1000.0 << " μs per snapshot\n";
     }
 
+    void benchmark_lock_contention() {
+        std::cout << "\n=== LOCK CONTENTION ANALYSIS ===\n";
+        
+        OrderBook ob(1000000);
+        setup_market_liquidity(ob);
+        ob.resetStats();
+        ob.setLockStatsEnabled(true);
+        
+        constexpr int NUM_ORDERS = 100000;
+        constexpr int QUERY_THREADS = 2;
+        std::cout << "Matching " << NUM_ORDERS << " orders against " << QUERY_THREADS
+                  << " market data query threads...\n";
+        
+        std::atomic<bool> done{false};
+        std::vector<std::thread> readers;
+        for (int t = 0; t < QUERY_THREADS; ++t) {
+            readers.emplace_back([&ob, &done, t]() {
+                double sink = 0;
+                while (!done.load(std::memory_order_relaxed)) {
+                    if (t % 2 == 0) {
+                        sink += ob.bestBid() + ob.bestAsk();
+                    } else {
+                        auto levels = ob.getTopLevels(Side::Buy, 10);
+                        sink += levels.size();
+                    }
+                    std::this_thread::yield();
+                }
+                if (sink < 0) std::cout << "Unexpected negative sum\n";
+            });
+        }
+        
+        std::vector<Fill> fills;
+        for (int i = 0; i < NUM_ORDERS; ++i) {
+            fills.clear();
+            ob.submitOrder(generate_random_order(), &fills);
+        }
+        done.store(true);
+        for (auto& reader : readers) reader.join();
+        ob.setLockStatsEnabled(false);
+        
+        const auto& stats = ob.getStats();
+        std::cout << "\n" << std::left << std::setw(22) << "Call site"
+                  << std::right << std::setw(10) << "Acquires"
+                  << std::setw(12) << "Wait avg"
+                  << std::setw(12) << "Wait p99"
+                  << std::setw(12) << "Wait max"
+                  << std::setw(12) << "Hold avg"
+                  << std::setw(12) << "Hold p99"
+                  << std::setw(12) << "Hold max" << "\n";
+        
+        for (size_t i = 0; i < static_cast<size_t>(LockSite::Count); ++i) {
+            LockSite site = static_cast<LockSite>(i);
+            const auto& s = stats.getLockStats(site);
+            if (s.wait.getCount() == 0) continue;
+            
+            std::cout << std::left << std::setw(22) << lockSiteName(site)
+                      << std::right << std::setw(10) << s.wait.getCount()
+                      << std::fixed << std::setprecision(0)
+                      << std::setw(10) << s.wait.getMeanNs() << "ns"
+                      << std::setw(10) << s.wait.getPercentileNs(99) << "ns"
+                      << std::setw(10) << s.wait.getMaxNs() << "ns"
+                      << std::setw(10) << s.hold.getMeanNs() << "ns"
+                      << std::setw(10) << s.hold.getPercentileNs(99) << "ns"
+                      << std::setw(10) << s.hold.getMaxNs() << "ns\n";
+        }
+        std::cout << "(percentiles are log2 bucket upper bounds)\n";
+    }
+
+    void benchmark_reader_writer() {
+        std::cout << "\n=== READER-WRITER MODE BENCHMARK ===\n";
+        
+        constexpr int THREADS = 4;
+        constexpr int OPS_PER_THREAD = 200000;
+        constexpr int LIVE_PER_THREAD = 500;
+        std::cout << THREADS << " threads x " << OPS_PER_THREAD << " ops; reads rotate getTopLevels(10), "
+                  << "getTotalVolume, getWeightedMidPrice; writes submit or cancel the thread's own orders\n\n";
+        
+        auto run = [&](ConcurrencyMode mode, int read_percent, double& read_ns, double& write_ns) {
+            OrderBook ob(1000000);
+            ob.setConcurrencyMode(mode);
+            for (int level = 0; level < 50; ++level) {
+                ob.submitOrder({uint64_t(2 * level + 1), Side::Buy, 5200000 - level * 1000, 100,
+                                OrderType::Limit, TimeInForce::GTC, 1, 0});
+                ob.submitOrder({uint64_t(2 * level + 2), Side::Sell, 5200100 + level * 1000, 100,
+                                OrderType::Limit, TimeInForce::GTC, 2, 0});
+            }
+            
+            std::atomic<uint64_t> read_total{0}, write_total{0}, reads{0}, writes{0};
+            std::vector<std::thread> threads;
+            auto start = high_resolution_clock::now();
+            for (int t = 0; t < THREADS; ++t) {
+                threads.emplace_back([&, t] {
+                    std::mt19937_64 rng(t + 1);
+                    std::deque<uint64_t> live;
+                    uint64_t next_id = (uint64_t(t) + 1) << 40;
+                    uint64_t r_ns = 0, w_ns = 0, r = 0, w = 0;
+                    double sink = 0;
+                    for (int i = 0; i < OPS_PER_THREAD; ++i) {
+                        bool read = int(rng() % 100) < read_percent;
+                        auto op_start = high_resolution_clock::now();
+                        if (read) {
+                            switch (i % 3) {
+                                case 0: sink += ob.getTopLevels(Side::Buy, 10).size(); break;
+                                case 1: sink += double(ob.getTotalVolume(Side::Sell)); break;
+                                default: sink += ob.getWeightedMidPrice(); break;
+                            }
+                        } else if (live.size() < LIVE_PER_THREAD || (rng() & 1)) {
+                            // Passive orders a few ticks off the touch, so writers don't trade
+                            Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+                            int64_t offset = 5 + int64_t(rng() % 50);
+                            ob.submitOrder({next_id, side, side == Side::Buy ? 5200000 - offset * 100 : 5200100 + offset * 100,
+                                            1 + uint32_t(rng() % 100), OrderType::Limit, TimeInForce::GTC,
+                                            uint32_t(1000 + t), 0});
+                            live.push_back(next_id++);
+                        } else {
+                            ob.cancelOrder(live.front());
+                            live.pop_front();
+                        }
+                        uint64_t ns = duration_cast<nanoseconds>(high_resolution_clock::now() - op_start).count();
+                        if (read) { r_ns += ns; ++r; } else { w_ns += ns; ++w; }
+                    }
+                    read_total += r_ns; write_total += w_ns; reads += r; writes += w;
+                    if (sink < -1e18) std::cout << "Unexpected sum\n";
+                });
+            }
+            for (auto& th : threads) th.join();
+            double seconds = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+            read_ns = reads ? read_total / double(reads) : 0.0;
+            write_ns = writes ? write_total / double(writes) : 0.0;
+            return THREADS * OPS_PER_THREAD / seconds;
+        };
+        
+        std::cout << std::left << std::setw(9) << "Reads" << std::setw(17) << "Mode" << std::right
+                  << std::setw(12) << "Mops/s" << std::setw(14) << "Read avg" << std::setw(14) << "Write avg" << "\n";
+        for (int read_percent : {50, 90, 99}) {
+            for (ConcurrencyMode mode : {ConcurrencyMode::Exclusive, ConcurrencyMode::SharedReaders}) {
+                double read_ns = 0, write_ns = 0;
+                double ops = run(mode, read_percent, read_ns, write_ns);
+                std::cout << std::left << std::setw(9) << (std::to_string(read_percent) + "%")
+                          << std::setw(17) << concurrencyModeName(mode) << std::right << std::fixed
+                          << std::setprecision(2) << std::setw(12) << ops / 1e6
+                          << std::setprecision(0) << std::setw(12) << read_ns << "ns"
+                          << std::setw(12) << write_ns << "ns\n";
+            }
+        }
+    }
+
+    void benchmark_lock_policies() {
+        std::cout << "\n=== LOCK POLICY BENCHMARK ===\n";
+        
+        constexpr int TOTAL_OPS = 400000;
+        constexpr int LIVE_PER_THREAD = 200;
+        const unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+        std::cout << TOTAL_OPS << " submit/cancel ops split across the threads, each working its own "
+                  << "passive orders on one shared book (" << cpus << " CPUs)\n\n";
+        
+        auto run = [&](ConcurrencyMode mode, int thread_count, LatencyHistogram& latency) {
+            OrderBook ob(1000000);
+            ob.setConcurrencyMode(mode);
+            ob.submitOrder({1, Side::Buy, 5200000, 100, OrderType::Limit, TimeInForce::GTC, 1, 0});
+            ob.submitOrder({2, Side::Sell, 5200100, 100, OrderType::Limit, TimeInForce::GTC, 2, 0});
+            
+            const int ops_per_thread = TOTAL_OPS / thread_count;
+            std::vector<LatencyHistogram> per_thread(thread_count);
+            std::vector<std::thread> threads;
+            auto start = high_resolution_clock::now();
+            for (int t = 0; t < thread_count; ++t) {
+                threads.emplace_back([&, t] {
+                    std::mt19937_64 rng(t + 1);
+                    std::deque<uint64_t> live;
+                    uint64_t next_id = (uint64_t(t) + 1) << 40;
+                    for (int i = 0; i < ops_per_thread; ++i) {
+                        auto op_start = high_resolution_clock::now();
+                        if (live.size() < LIVE_PER_THREAD || (rng() & 1)) {
+                            Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+                            int64_t offset = 5 + int64_t(rng() % 50);
+                            ob.submitOrder({next_id, side, side == Side::Buy ? 5200000 - offset * 100 : 5200100 + offset * 100,
+                                            1 + uint32_t(rng() % 100), OrderType::Limit, TimeInForce::GTC,
+                                            uint32_t(1000 + t), 0});
+                            live.push_back(next_id++);
+                        } else {
+                            ob.cancelOrder(live.front());
+                            live.pop_front();
+                        }
+                        per_thread[t].record(duration_cast<nanoseconds>(high_resolution_clock::now() - op_start).count());
+                    }
+                });
+            }
+            for (auto& th : threads) th.join();
+            double seconds = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+            for (auto& h : per_thread) latency.merge(h);
+            return ops_per_thread * thread_count / seconds;
+        };
+        
+        std::cout << std::left << std::setw(9) << "Threads" << std::setw(17) << "Lock" << std::right
+                  << std::setw(10) << "Mops/s" << std::setw(12) << "Mean" << std::setw(12) << "P99"
+                  << std::setw(14) << "P99.9" << "\n";
+        for (int thread_count : {1, 2, 4, 8, 16}) {
+            for (ConcurrencyMode mode : {ConcurrencyMode::Exclusive, ConcurrencyMode::TicketSpin,
+                                         ConcurrencyMode::AdaptiveSpin, ConcurrencyMode::SingleThreaded}) {
+                // Without a lock only one thread may touch the book
+                if (mode == ConcurrencyMode::SingleThreaded && thread_count > 1) continue;
+                if (mode == ConcurrencyMode::TicketSpin && unsigned(thread_count) > cpus) {
+                    std::cout << std::left << std::setw(9) << thread_count << std::setw(17) << concurrencyModeName(mode)
+                              << "skipped: more threads than CPUs\n";
+                    continue;
+                }
+                LatencyHistogram latency;
+                double ops = run(mode, thread_count, latency);
+                std::cout << std::left << std::setw(9) << thread_count << std::setw(17) << concurrencyModeName(mode)
+                          << std::right << std::fixed << std::setprecision(2) << std::setw(10) << ops / 1e6
+                          << std::setprecision(0) << std::setw(10) << latency.getMeanNs() << "ns"
+                          << std::setw(10) << latency.getPercentileNs(99) << "ns"
+                          << std::setw(12) << latency.getPercentileNs(99.9) << "ns\n";
+            }
+        }
+        std::cout << "(spin locks only pay off with a free core per thread; oversubscribed, the ticket lock's\n"
+                  << " FIFO hand-off waits for each descheduled waiter to be scheduled in turn)\n";
+    }
+
+    void benchmark_depth_snapshot() {
+        std::cout << "\n=== DEPTH SNAPSHOT BENCHMARK ===\n";
+        
+        constexpr int ORDERS = 300000;
+        constexpr int READERS = 2;
+        std::cout << "One matcher thread submits " << ORDERS << " orders while " << READERS
+                  << " threads poll getTopLevels(side, 10)\n\n";
+        
+        auto run = [&](bool snapshot, int readers, double& reads_per_sec) {
+            OrderBook ob(1000000);
+            ob.setDepthSnapshotEnabled(snapshot);
+            std::mt19937_64 rng(5);
+            
+            std::atomic<bool> done{false};
+            std::atomic<uint64_t> reads{0};
+            std::vector<std::thread> threads;
+            for (int t = 0; t < readers; ++t) {
+                threads.emplace_back([&, t] {
+                    uint64_t local = 0, sink = 0;
+                    while (!done.load(std::memory_order_relaxed)) {
+                        sink += ob.getTopLevels(t % 2 ? Side::Sell : Side::Buy, 10).size();
+                        ++local;
+                    }
+                    reads += local + (sink == UINT64_MAX);
+                });
+            }
+            
+            LatencyHistogram submit_latency;
+            std::vector<Fill> fills;
+            fills.reserve(1024);
+            auto start = high_resolution_clock::now();
+            for (int i = 0; i < ORDERS; ++i) {
+                Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+                int64_t offset = int64_t(rng() % 200) - 10;
+                fills.clear();
+                auto op_start = high_resolution_clock::now();
+                ob.submitOrder({uint64_t(i + 1), side, side == Side::Buy ? 500000 - offset : 500000 + offset,
+                                1 + uint32_t(rng() % 100), OrderType::Limit, TimeInForce::GTC,
+                                uint32_t(rng() % 64), 0}, &fills);
+                if (i >= 20000) ob.cancelOrder(uint64_t(i + 1 - 20000));
+                submit_latency.record(duration_cast<nanoseconds>(high_resolution_clock::now() - op_start).count());
+            }
+            double seconds = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+            done = true;
+            for (auto& th : threads) th.join();
+            
+            reads_per_sec = reads / seconds;
+            std::cout << std::left << std::setw(28)
+                      << (std::string(snapshot ? "Snapshot" : "Locked") + (readers ? " + readers" : ", no readers"))
+                      << std::right << std::fixed << std::setprecision(0)
+                      << std::setw(10) << submit_latency.getMeanNs() << "ns"
+                      << std::setw(10) << submit_latency.getPercentileNs(99) << "ns"
+                      << std::setw(12) << std::setprecision(2) << reads_per_sec / 1e6 << "\n";
+        };
+        
+        std::cout << std::left << std::setw(28) << "getTopLevels(10) source" << std::right
+                  << std::setw(12) << "Order avg" << std::setw(12) << "Order p99" << std::setw(12) << "Mreads/s" << "\n";
+        double reads = 0;
+        run(false, 0, reads);
+        run(true, 0, reads);
+        run(false, READERS, reads);
+        run(true, READERS, reads);
+        std::cout << "(p99 is a log2 bucket upper bound; order latency includes the cancel that follows)\n";
+    }
+
+    void benchmark_event_pipeline() {
+        std::cout << "\n=== POST-MATCH EVENT PIPELINE BENCHMARK ===\n";
+        
+        constexpr int ORDERS = 200000;
+        std::cout << ORDERS << " orders; every fill is journaled, fed to market data, drop copy and risk.\n"
+                  << "Inline: all four run in the fill handler under the book mutex.\n"
+                  << "Ring: the handler publishes to an EventRing; each task is its own consumer thread "
+                  << "(drop copy after journal)\n\n";
+        
+        // Stand-ins for the downstream tasks, each a few hundred ns per event
+        struct Downstream {
+            std::vector<char> journal = std::vector<char>(1 << 20);
+            size_t journalPos = 0;
+            uint64_t checksum = 1469598103934665603ull;
+            uint64_t journaled = 0;
+            int64_t lastPrice = 0;
+            std::vector<uint64_t> volumeAtPrice = std::vector<uint64_t>(4096);
+            std::vector<Fill> dropCopy = std::vector<Fill>(1 << 16);
+            uint64_t copied = 0;
+            std::vector<int64_t> exposure = std::vector<int64_t>(1024);
+            
+            void journalFill(const Fill& fill) {
+                if (journalPos + 64 > journal.size()) journalPos = 0;
+                char* record = journal.data() + journalPos;
+                std::memset(record, 0, 64);
+                std::memcpy(record, &fill, sizeof(Fill));
+                for (int i = 0; i < 64; ++i) checksum = (checksum ^ uint8_t(record[i])) * 1099511628211ull;
+                journalPos += 64;
+                ++journaled;
+            }
+            void marketData(const Fill& fill) {
+                lastPrice = fill.priceTick;
+                volumeAtPrice[uint64_t(fill.priceTick) & 4095] += fill.quantity;
+            }
+            void dropCopyFill(const Fill& fill) {
+                dropCopy[copied++ & 0xFFFF] = fill;
+            }
+            void risk(const Fill& fill) {
+                int64_t notional = fill.priceTick * int64_t(fill.quantity);
+                exposure[fill.makerOrderId & 1023] -= notional;
+                exposure[fill.takerOrderId & 1023] += notional;
+            }
+        };
+        
+        auto run = [&](bool ring_mode) {
+            OrderBook ob(1000000);
+            Downstream work;
+            EventRing<BookEvent> events(1 << 16);
+            std::vector<std::unique_ptr<EngineRunner>> consumers;
+            bool order_ok = true;
+            
+            if (ring_mode) {
+                auto& journal = events.addConsumer();
+                auto& drop_copy = events.addConsumer({&journal});
+                auto& market_data = events.addConsumer();
+                auto& risk = events.addConsumer();
+                EngineRunner::Options options;
+                consumers.push_back(std::make_unique<EngineRunner>(options, [&] {
+                    return journal.poll([&](const BookEvent& e, uint64_t) { work.journalFill(e.fill); });
+                }));
+                consumers.push_back(std::make_unique<EngineRunner>(options, [&] {
+                    return drop_copy.poll([&](const BookEvent& e, uint64_t seq) {
+                        if (journal.consumed() <= seq) order_ok = false;
+                        work.dropCopyFill(e.fill);
+                    });
+                }));
+                consumers.push_back(std::make_unique<EngineRunner>(options, [&] {
+                    return market_data.poll([&](const BookEvent& e, uint64_t) { work.marketData(e.fill); });
+                }));
+                consumers.push_back(std::make_unique<EngineRunner>(options, [&] {
+                    return risk.poll([&](const BookEvent& e, uint64_t) { work.risk(e.fill); });
+                }));
+                ob.setFillHandler(publishFillsTo(events));
+            } else {
+                ob.setFillHandler([&](const Fill& fill) {
+                    work.journalFill(fill);
+                    work.dropCopyFill(fill);
+                    work.marketData(fill);
+                    work.risk(fill);
+                });
+            }
+            
+            std::mt19937_64 rng(5);
+            LatencyHistogram submit_latency;
+            auto start = high_resolution_clock::now();
+            for (int i = 0; i < ORDERS; ++i) {
+                Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+                int64_t offset = int64_t(rng() % 200) - 30;
+                auto op_start = high_resolution_clock::now();
+                ob.submitOrder({uint64_t(i + 1), side, side == Side::Buy ? 500000 - offset : 500000 + offset,
+                                1 + uint32_t(rng() % 100), OrderType::Limit, TimeInForce::GTC,
+                                uint32_t(rng() % 64), 0});
+                submit_latency.record(duration_cast<nanoseconds>(high_resolution_clock::now() - op_start).count());
+            }
+            double match_seconds = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+            for (auto& consumer : consumers) consumer->stop();
+            double total_seconds = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+            
+            uint64_t fills = ob.getStats().getFillsGenerated();
+            bool complete = !ring_mode || (work.journaled == fills && work.copied == fills);
+            std::cout << std::left << std::setw(8) << (ring_mode ? "Ring" : "Inline") << std::right << std::fixed
+                      << std::setprecision(0) << std::setw(10) << submit_latency.getMeanNs() << "ns"
+                      << std::setw(10) << submit_latency.getPercentileNs(99) << "ns"
+                      << std::setw(10) << submit_latency.getMaxNs() << "ns"
+                      << std::setprecision(2) << std::setw(12) << ORDERS / match_seconds / 1e6
+                      << std::setw(12) << ORDERS / total_seconds / 1e6
+                      << std::setw(10) << fills << std::setw(10) << events.producerWaits()
+                      << "   " << (complete && order_ok ? "ok" : "MISMATCH") << "\n";
+        };
+        
+        std::cout << std::left << std::setw(8) << "Mode" << std::right << std::setw(12) << "Order avg"
+                  << std::setw(12) << "Order p99" << std::setw(12) << "Order max" << std::setw(12) << "Match Mo/s"
+                  << std::setw(12) << "E2E Mo/s" << std::setw(10) << "Fills" << std::setw(10) << "Waits" << "\n";
+        run(false);
+        run(true);
+        std::cout << "(E2E includes draining the consumers. Waits: publishes that found the ring full."
+                  << " Consumers want\n cores of their own; sharing the matcher's core they compete with it)\n";
+    }
+
+    void benchmark_memory_footprint() {
+        std::cout << "\n=== MEMORY FOOTPRINT BY BOOK SIZE ===\n";
+        std::cout << "(bytes obtained from the system allocator; excludes malloc headers)\n\n";
+        
+        std::cout << std::left << std::setw(34) << "Layout"
+                  << std::right << std::setw(10) << "Orders"
+                  << std::setw(12) << "Orders KB"
+                  << std::setw(12) << "Levels KB"
+                  << std::setw(12) << "Index KB"
+                  << std::setw(12) << "Total KB"
+                  << std::setw(12) << "B/order" << "\n";
+        
+        const std::string layout = "OrderBook (" + std::to_string(OrderBook::coldOrderBytes()) + " B cold + " +
+                                   std::to_string(OrderBook::hotOrderBytes()) + " B hot)";
+        
+        for (size_t numOrders : {size_t(1000), size_t(100000), size_t(1000000)}) {
+            size_t levelsPerSide = std::max<size_t>(10, numOrders / 200);
+            
+            // Current OrderBook layout
+            {
+                OrderBook ob(numOrders);
+                for (size_t i = 0; i < numOrders; ++i) {
+                    bool buy = (i % 2) == 0;
+                    int64_t offset = static_cast<int64_t>((i / 2) % levelsPerSide);
+                    Order order{i + 1, buy ? Side::Buy : Side::Sell,
+                                buy ? 50000 - offset : 50001 + offset, 100,
+                                OrderType::Limit, TimeInForce::GTC, uint32_t(i % 100), 0};
+                    ob.submitOrder(order);
+                }
+                
+                auto usage = ob.memoryUsage();
+                print_footprint_row(layout.c_str(), usage.restingOrders,
+                                    usage.orderBytes, usage.levelBytes, usage.indexBytes);
+            }
+            
+            // Reference: node-based std containers with deque levels
+            {
+                CountingResource orderCounter, levelCounter;
+                std::pmr::unordered_map<uint64_t, Order> orders(&orderCounter);
+                std::pmr::map<int64_t, std::pmr::deque<Order*>> bids(&levelCounter), asks(&levelCounter);
+                orders.reserve(numOrders);
+                size_t indexBytes = orderCounter.bytesInUse();
+                
+                for (size_t i = 0; i < numOrders; ++i) {
+                    bool buy = (i % 2) == 0;
+                    int64_t offset = static_cast<int64_t>((i / 2) % levelsPerSide);
+                    Order order{i + 1, buy ? Side::Buy : Side::Sell,
+                                buy ? 50000 - offset : 50001 + offset, 100,
+                                OrderType::Limit, TimeInForce::GTC, uint32_t(i % 100), 0};
+                    Order* stored = &orders.emplace(order.id, order).first->second;
+                    (buy ? bids : asks)[order.priceTick].push_back(stored);
+                }
+                
+                // Order records live inside the hash nodes in this layout
+                print_footprint_row("std::unordered_map + map<deque>", orders.size(),
+                                    orderCounter.bytesInUse() - indexBytes,
+                                    levelCounter.bytesInUse(), indexBytes);
+            }
+        }
+        
+        OrderBook empty(0);
+        auto usage = empty.memoryUsage();
+        std::cout << "\nEmpty book footprint: " << usage.totalBytes() << " bytes ("
+                  << usage.bufferBytes << " fixed per-book overhead)\n";
+    }
+
+    void benchmark_simd_kernels() {
+        std::cout << "\n=== SIMD DEPTH KERNEL BENCHMARK ===\n";
+        std::cout << "Detected ISA: " << HFTSimd::isaName(HFTSimd::detectedIsa()) << "\n";
+        
+        // Cross-check every available implementation against the scalar kernels
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<uint32_t> qty_dist(0, 1000);
+        std::uniform_int_distribution<uint32_t> owner_dist(1, 4);
+        bool kernels_match = true;
+        for (int trial = 0; trial < 2000 && kernels_match; ++trial) {
+            uint32_t n = rng() % 300;
+            std::vector<uint32_t> qtys(n), owners(n);
+            for (uint32_t i = 0; i < n; ++i) {
+                qtys[i] = (rng() % 4 == 0) ? 0 : qty_dist(rng);
+                owners[i] = owner_dist(rng);
+            }
+            uint64_t target = rng() % (n * 600 + 1);
+            
+            HFTSimd::setIsa(HFTSimd::Isa::Scalar);
+            uint64_t ref_sum = HFTSimd::sumQuantities(qtys.data(), n);
+            uint64_t ref_prefix_sum = 0;
+            uint32_t ref_index = HFTSimd::findFillPrefix(qtys.data(), owners.data(), n, 2, target, ref_prefix_sum);
+            
+            for (auto isa : {HFTSimd::Isa::SSE41, HFTSimd::Isa::AVX2}) {
+                if (HFTSimd::setIsa(isa) != isa) continue;
+                uint64_t prefix_sum = 0;
+                uint32_t index = HFTSimd::findFillPrefix(qtys.data(), owners.data(), n, 2, target, prefix_sum);
+                if (HFTSimd::sumQuantities(qtys.data(), n) != ref_sum ||
+                    index != ref_index || prefix_sum != ref_prefix_sum) {
+                    std::cout << "❌ " << HFTSimd::isaName(isa) << " kernel mismatch (n=" << n << ")\n";
+                    kernels_match = false;
+                }
+            }
+        }
+        if (kernels_match) std::cout << "✅ All kernels agree with scalar reference\n";
+        
+        // Deep book: 50 levels x 400 orders per side, a quarter of them cancelled
+        constexpr int LEVELS = 50;
+        constexpr int ORDERS_PER_LEVEL = 400;
+        OrderBook ob(LEVELS * ORDERS_PER_LEVEL * 2);
+        uint64_t order_id = 1;
+        for (int level = 0; level < LEVELS; ++level) {
+            for (int j = 0; j < ORDERS_PER_LEVEL; ++j) {
+                ob.submitOrder({order_id++, Side::Sell, (50001 + level) * TICK_PRECISION, 1 + uint32_t(j % 50),
+                                OrderType::Limit, TimeInForce::GTC, uint32_t(1 + j % 16), 0});
+                ob.submitOrder({order_id++, Side::Buy, (49999 - level) * TICK_PRECISION, 1 + uint32_t(j % 50),
+                                OrderType::Limit, TimeInForce::GTC, uint32_t(1 + j % 16), 0});
+            }
+        }
+        for (uint64_t id = 1; id + 1 < order_id; id += 8) {
+            ob.cancelOrder(id);        // ask
+            ob.cancelOrder(id + 1);    // bid
+        }
+        
+        uint64_t ask_volume = ob.getTotalVolume(Side::Sell);
+        std::cout << "Book: " << LEVELS << " levels x " << ORDERS_PER_LEVEL
+                  << " orders per side (25% cancelled), ask volume " << ask_volume << "\n\n";
+        
+        constexpr int ITERATIONS = 2000;
+        std::cout << std::left << std::setw(10) << "ISA"
+                  << std::right << std::setw(16) << "TotalVolume"
+                  << std::setw(16) << "TopLevels(10)"
+                  << std::setw(16) << "FOK reject" << "\n";
+        
+        for (auto isa : {HFTSimd::Isa::Scalar, HFTSimd::Isa::SSE41, HFTSimd::Isa::AVX2}) {
+            if (HFTSimd::setIsa(isa) != isa) continue;
+            uint64_t sink = 0;
+            
+            auto start = high_resolution_clock::now();
+            for (int i = 0; i < ITERATIONS; ++i) sink += ob.getTotalVolume(Side::Sell);
+            auto volume_ns = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count();
+            
+            start = high_resolution_clock::now();
+            for (int i = 0; i < ITERATIONS; ++i) sink += ob.getTopLevels(Side::Buy, 10).size();
+            auto levels_ns = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count();
+            
+            // Asks for one more than the book holds, so every check scans all levels and rejects
+            start = high_resolution_clock::now();
+            for (int i = 0; i < ITERATIONS; ++i) {
+                sink += ob.submitOrder({order_id++, Side::Buy, (50001 + LEVELS) * TICK_PRECISION,
+                                        uint32_t(ask_volume + 1), OrderType::Limit, TimeInForce::FOK, 999, 0});
+            }
+            auto fok_ns = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count();
+            
+            std::cout << std::left << std::setw(10) << HFTSimd::isaName(isa) << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(13) << volume_ns / double(ITERATIONS) / 1000.0 << " μs"
+                      << std::setw(13) << levels_ns / double(ITERATIONS) / 1000.0 << " μs"
+                      << std::setw(13) << fok_ns / double(ITERATIONS) / 1000.0 << " μs"
+                      << (sink == 0 ? " " : "") << "\n";
+        }
+        
+        HFTSimd::setIsa(HFTSimd::detectedIsa());
+    }
+
+    void benchmark_numa_placement() {
+        std::cout << "\n=== NUMA PLACEMENT BENCHMARK ===\n";
+        
+        int nodes = HFTNuma::nodeCount();
+        std::cout << "NUMA nodes: " << nodes << "\n";
+        for (int node = 0; node < nodes; ++node) {
+            std::cout << "  node " << node << ": " << HFTNuma::cpusOfNode(node).size() << " CPUs\n";
+        }
+        
+        constexpr size_t MAX_ORDERS = 400000;
+        constexpr int RESTING = 300000;
+        constexpr int OPS = 300000;
+        const int engine_cpu = HFTNuma::cpusOfNode(0).empty() ? -1 : HFTNuma::cpusOfNode(0).front();
+        std::cout << "Engine thread pinned to CPU " << engine_cpu << " (node 0); "
+                  << RESTING << " resting orders, " << OPS << " random cancel/replace ops\n\n";
+        
+        std::cout << std::left << std::setw(22) << "Book memory"
+                  << std::setw(16) << "Landed on"
+                  << std::right << std::setw(14) << "Per op" << "\n";
+        std::cout << std::string(52, '-') << "\n";
+        
+        auto run = [&](const char* label, int memory_node) {
+            double ns_per_op = 0;
+            int landed = -1;
+            std::thread engine([&] {
+                OrderBook::MemoryOptions placement;
+                placement.numaNode = memory_node;
+                placement.cpu = engine_cpu;
+                OrderBook ob(MAX_ORDERS, placement);
+                ob.pinEngineThread();
+                landed = HFTNuma::nodeOfAddress(ob.ownedArena()->data());
+                
+                std::mt19937_64 rng(5);
+                for (int i = 0; i < RESTING; ++i) {
+                    Side side = (i & 1) ? Side::Buy : Side::Sell;
+                    int64_t offset = 1 + static_cast<int64_t>(rng() % 2000);
+                    ob.submitOrder({uint64_t(i + 1), side, (side == Side::Buy) ? 500000 - offset : 500000 + offset,
+                                    10, OrderType::Limit, TimeInForce::GTC, uint32_t(i % 64), 0});
+                }
+                
+                // Cancel a random resting order and replace it elsewhere in the book
+                std::vector<uint64_t> live(RESTING);
+                for (int i = 0; i < RESTING; ++i) live[i] = uint64_t(i + 1);
+                uint64_t next_id = RESTING + 1;
+                auto start = high_resolution_clock::now();
+                for (int i = 0; i < OPS; ++i) {
+                    size_t slot = rng() % live.size();
+                    ob.cancelOrder(live[slot]);
+                    Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+                    int64_t offset = 1 + static_cast<int64_t>(rng() % 2000);
+                    ob.submitOrder({next_id, side, (side == Side::Buy) ? 500000 - offset : 500000 + offset,
+                                    10, OrderType::Limit, TimeInForce::GTC, uint32_t(i % 64), 0});
+                    live[slot] = next_id++;
+                }
+                ns_per_op = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / double(OPS);
+            });
+            engine.join();
+            
+            std::cout << std::left << std::setw(22) << label
+                      << std::setw(16) << (landed >= 0 ? "node " + std::to_string(landed) : std::string("unknown"))
+                      << std::right << std::fixed << std::setprecision(1) << std::setw(11) << ns_per_op << " ns\n";
+        };
+        
+        run("Local (node 0)", 0);
+        if (nodes > 1) {
+            run(("Remote (node " + std::to_string(nodes - 1) + ")").c_str(), nodes - 1);
+        } else {
+            std::cout << "(single-node host: remote placement not possible, binding is a no-op)\n";
+        }
+    }
+
+    void benchmark_cold_start() {
+        std::cout << "\n=== COLD START BENCHMARK ===\n";
+        
+        static constexpr size_t MAX_ORDERS = 200000;
+        constexpr int OPS = 200000;
+        std::cout << "First " << OPS << " ops on a fresh book sized for " << MAX_ORDERS << " orders\n\n";
+        std::cout << std::left << std::setw(34) << "Configuration"
+                  << std::right << std::setw(12) << "Setup"
+                  << std::setw(12) << "First 1K"
+                  << std::setw(12) << "All ops"
+                  << std::setw(12) << "P99"
+                  << std::setw(14) << "Page faults" << "\n";
+        std::cout << std::string(96, '-') << "\n";
+        
+        auto run = [&](const char* label, auto make_book, bool warm) {
+            auto setup_start = high_resolution_clock::now();
+            auto ob = make_book();
+            if (warm) ob->warmup();
+            double setup_ms = duration_cast<microseconds>(high_resolution_clock::now() - setup_start).count() / 1000.0;
+            
+            std::mt19937_64 rng(11);
+            std::vector<Fill> fills;
+            fills.reserve(1024);
+            std::vector<uint64_t> latencies;
+            latencies.reserve(OPS);
+            long faults_before = minor_page_faults();
+            
+            for (int i = 0; i < OPS; ++i) {
+                Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+                int64_t offset = static_cast<int64_t>(rng() % 500) - 5;
+                Order order{uint64_t(i + 1), side, (side == Side::Buy) ? 500000 - offset : 500000 + offset,
+                            1 + uint32_t(rng() % 100), OrderType::Limit, TimeInForce::GTC, uint32_t(rng() % 64), 0};
+                fills.clear();
+                auto start = high_resolution_clock::now();
+                ob->submitOrder(order, &fills);
+                latencies.push_back(duration_cast<nanoseconds>(high_resolution_clock::now() - start).count());
+            }
+            
+            long faults = minor_page_faults() - faults_before;
+            double first_k = 0;
+            for (int i = 0; i < 1000; ++i) first_k += latencies[i];
+            double total = 0;
+            for (uint64_t ns : latencies) total += ns;
+            std::sort(latencies.begin(), latencies.end());
+            
+            std::cout << std::left << std::setw(34) << label << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(9) << setup_ms << " ms"
+                      << std::setw(9) << first_k / 1000 << " ns"
+                      << std::setw(9) << total / OPS << " ns"
+                      << std::setw(9) << double(latencies[OPS * 99 / 100]) << " ns"
+                      << std::setw(14) << faults << "\n";
+            return ob;
+        };
+        
+        run("Default heap", [] { return std::make_unique<OrderBook>(MAX_ORDERS); }, false);
+        run("Arena, prefaulted", [] {
+            return std::make_unique<OrderBook>(MAX_ORDERS, OrderBook::MemoryOptions{false, true});
+        }, false);
+        auto last = run("Arena, huge pages, prefault+warmup", [] {
+            return std::make_unique<OrderBook>(MAX_ORDERS, OrderBook::MemoryOptions{true, true});
+        }, true);
+        
+        const ArenaResource* arena = last->ownedArena();
+        std::cout << "\nArena: " << arena->capacity() / (1 << 20) << " MB backed by "
+                  << arenaBackingName(arena->backing()) << ", "
+                  << arena->bytesUsed() / (1 << 20) << " MB used, "
+                  << arena->overflowBytes() << " bytes spilled\n";
+    }
+
+    void benchmark_multi_book_memory() {
+        std::cout << "\n=== MULTI-BOOK MEMORY RESOURCE BENCHMARK ===\n";
+        
+        constexpr int OPS_PER_BOOK = 300000;
+        constexpr size_t ARENA_BYTES = 64 << 20;
+        unsigned threads = std::max(2u, std::min(8u, std::thread::hardware_concurrency()));
+        std::cout << threads << " threads, one book each, " << OPS_PER_BOOK
+                  << " mixed submit/cancel ops per book from a cold start\n\n";
+        
+        // Each thread builds and trades its own book; only the upstream resource differs
+        auto run = [&](bool use_arena) {
+            std::atomic<uint64_t> total_ns{0};
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    std::optional<ArenaResource> arena;
+                    if (use_arena) arena.emplace(ARENA_BYTES);
+                    std::pmr::memory_resource* upstream = use_arena ? &*arena : std::pmr::get_default_resource();
+                    
+                    std::mt19937_64 rng(t + 1);
+                    std::vector<Fill> fills;
+                    fills.reserve(1024);
+                    auto start = high_resolution_clock::now();
+                    {
+                        OrderBook ob(100000, upstream);
+                        for (int i = 0; i < OPS_PER_BOOK; ++i) {
+                            Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+                            int64_t offset = static_cast<int64_t>(rng() % 2000) - 20;
+                            fills.clear();
+                            ob.submitOrder({uint64_t(i + 1), side,
+                                            (side == Side::Buy) ? 500000 - offset : 500000 + offset,
+                                            1 + uint32_t(rng() % 100), OrderType::Limit, TimeInForce::GTC,
+                                            uint32_t(rng() % 64), 0}, &fills);
+                            if (i >= 50000) ob.cancelOrder(uint64_t(i + 1 - 50000));
+                        }
+                    }
+                    total_ns += duration_cast<nanoseconds>(high_resolution_clock::now() - start).count();
+                });
+            }
+            for (auto& w : workers) w.join();
+            return total_ns.load() / double(threads) / OPS_PER_BOOK;
+        };
+        
+        double heap_ns = run(false);
+        double arena_ns = run(true);
+        std::cout << std::left << std::setw(32) << "Default heap resource" << std::fixed << std::setprecision(1)
+                  << heap_ns << " ns/op\n";
+        std::cout << std::left << std::setw(32) << "Per-book ArenaResource" << arena_ns << " ns/op\n";
+    }
+
+    void benchmark_instruments() {
+        std::cout << "\n=== MULTI-INSTRUMENT BOOK MANAGER BENCHMARK ===\n";
+        
+        constexpr InstrumentId INSTRUMENTS = 10000;
+        constexpr InstrumentId HOT = 100;   // Instruments carrying 90% of the flow
+        constexpr int OPS = 1000000;
+        
+        // Footprint: untouched, then every instrument traded once and emptied
+        {
+            BookManager books(INSTRUMENTS);
+            auto print_row = [](const char* label, const BookManager::AggregateStats& s) {
+                std::cout << std::left << std::setw(34) << label << std::right
+                          << std::setw(7) << s.activeBooks << " books"
+                          << std::setw(10) << std::fixed << std::setprecision(1)
+                          << s.totalBytes() / double(1 << 20) << " MB\n";
+            };
+            print_row("Untouched", books.aggregateStats());
+            for (InstrumentId i = 0; i < INSTRUMENTS; ++i) {
+                books.submitOrder(i, {i + 1, Side::Buy, 50000, 10, OrderType::Limit, TimeInForce::GTC, 1, 0});
+            }
+            print_row("One resting order each", books.aggregateStats());
+            for (InstrumentId i = 0; i < INSTRUMENTS; ++i) books.cancelOrder(i + 1);
+            print_row("Traded once, now empty", books.aggregateStats());
+            books.releaseEmptyBooks();
+            print_row("After releaseEmptyBooks()", books.aggregateStats());
+            
+            OrderBook default_book;
+            std::cout << std::left << std::setw(34) << "Default-sized OrderBook x 10000" << std::right
+                      << std::setw(23) << std::fixed << std::setprecision(1)
+                      << default_book.memoryUsage().totalBytes() * double(INSTRUMENTS) / (1 << 20)
+                      << " MB (extrapolated)\n\n";
+        }
+        
+        // Skewed flow: submits on a random instrument, cancels and amends by order ID.
+        // The same stream is replayed against books the caller already knows the
+        // instrument for, to isolate the cost of routing through the manager.
+        std::cout << OPS << " ops over " << INSTRUMENTS << " instruments, 90% on the hottest " << HOT << "\n";
+        auto run = [&](bool routed) {
+            std::mt19937_64 rng(7);
+            auto pick_instrument = [&] {
+                return InstrumentId(rng() % 10 != 0 ? rng() % HOT : rng() % INSTRUMENTS);
+            };
+            
+            BookManager manager(INSTRUMENTS);
+            std::vector<std::unique_ptr<OrderBook>> direct(INSTRUMENTS);
+            std::vector<std::pair<uint64_t, InstrumentId>> live;
+            live.reserve(OPS);
+            std::vector<Fill> fills;
+            fills.reserve(1024);
+            uint64_t order_id = 1;
+            
+            auto start = high_resolution_clock::now();
+            for (int i = 0; i < OPS; ++i) {
+                int kind = int(rng() % 10);
+                fills.clear();
+                if (kind < 6 || live.empty()) {
+                    InstrumentId instrument = pick_instrument();
+                    Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+                    int64_t offset = int64_t(rng() % 50);
+                    Order order{order_id, side, side == Side::Buy ? 50000 - offset : 50001 + offset,
+                                1 + uint32_t(rng() % 100), OrderType::Limit, TimeInForce::GTC,
+                                uint32_t(rng() % 64), 0};
+                    if (routed) {
+                        manager.submitOrder(instrument, order, &fills);
+                    } else {
+                        if (!direct[instrument]) direct[instrument] = std::make_unique<OrderBook>(0);
+                        direct[instrument]->submitOrder(order, &fills);
+                    }
+                    live.emplace_back(order_id++, instrument);
+                } else {
+                    size_t pick = rng() % live.size();
+                    auto [id, instrument] = live[pick];
+                    int64_t price = 50000 + int64_t(rng() % 3) - 1;
+                    uint32_t qty = 1 + uint32_t(rng() % 100);
+                    if (kind < 9) {
+                        if (routed) manager.cancelOrder(id);
+                        else direct[instrument]->cancelOrder(id);
+                        live[pick] = live.back();
+                        live.pop_back();
+                    } else if (routed) {
+                        manager.modifyOrder(id, price, qty, &fills);
+                    } else {
+                        direct[instrument]->modifyOrder(id, price, qty, &fills);
+                    }
+                }
+            }
+            double ns = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / double(OPS);
+            
+            if (routed) {
+                auto stats = manager.aggregateStats();
+                std::cout << "Active books:    " << stats.activeBooks << " of " << INSTRUMENTS << "\n";
+                std::cout << "Resting orders:  " << stats.restingOrders << "\n";
+                std::cout << "Fills:           " << stats.fillsGenerated << "\n";
+                std::cout << "Memory:          " << std::fixed << std::setprecision(1)
+                          << stats.totalBytes() / double(1 << 20) << " MB ("
+                          << stats.routingBytes / 1024 << " KB routing)\n";
+            }
+            return ns;
+        };
+        
+        double routed_ns = run(true);
+        double direct_ns = run(false);
+        std::cout << "Routed by order ID:      " << std::fixed << std::setprecision(1) << routed_ns << " ns/op\n";
+        std::cout << "Caller-resolved books:   " << direct_ns << " ns/op\n";
+    }
+
+    void benchmark_sharded_scaling() {
+        std::cout << "\n=== SHARDED ENGINE SCALING BENCHMARK ===\n";
+        
+        constexpr InstrumentId INSTRUMENTS = 1000;
+        constexpr size_t OPS = 2000000;
+        unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        
+        // One multi-symbol command stream: 60% submits, 30% cancels, 10% amends
+        std::vector<EngineCommand> commands;
+        commands.reserve(OPS);
+        {
+            std::mt19937_64 rng(11);
+            std::vector<std::vector<uint64_t>> recent(INSTRUMENTS);
+            uint64_t order_id = 1;
+            for (size_t i = 0; i < OPS; ++i) {
+                InstrumentId instrument = InstrumentId(rng() % INSTRUMENTS);
+                auto& ids = recent[instrument];
+                int kind = int(rng() % 10);
+                Order order{};
+                if (kind < 6 || ids.empty()) {
+                    Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+                    int64_t offset = int64_t(rng() % 20);
+                    order = {order_id, side, side == Side::Buy ? 50000 - offset : 50001 + offset,
+                             1 + uint32_t(rng() % 100), OrderType::Limit, TimeInForce::GTC, uint32_t(rng() % 64), 0};
+                    ids.push_back(order_id++);
+                    commands.push_back({CommandType::Submit, instrument, order});
+                } else {
+                    size_t pick = rng() % ids.size();
+                    order.id = ids[pick];
+                    if (kind < 9) {
+                        ids[pick] = ids.back();
+                        ids.pop_back();
+                        commands.push_back({CommandType::Cancel, instrument, order});
+                    } else {
+                        order.priceTick = 50000 + int64_t(rng() % 3) - 1;
+                        order.quantity = 1 + uint32_t(rng() % 100);
+                        commands.push_back({CommandType::Modify, instrument, order});
+                    }
+                }
+            }
+        }
+        std::cout << OPS << " commands over " << INSTRUMENTS << " instruments, " << cores << " CPUs\n";
+        std::cout << "Shared: every thread calls any book through its mutex\n";
+        std::cout << "Sharded: one router thread feeds N pinned workers that own their books\n\n";
+        
+        // Each thread replays an interleaved slice of the stream against shared books
+        auto run_shared = [&](unsigned threads) {
+            std::vector<std::unique_ptr<OrderBook>> books(INSTRUMENTS);
+            for (auto& book : books) book = std::make_unique<OrderBook>(0);
+            std::vector<std::thread> workers;
+            auto start = high_resolution_clock::now();
+            for (unsigned t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    std::vector<Fill> fills;
+                    fills.reserve(256);
+                    for (size_t i = t; i < commands.size(); i += threads) {
+                        const EngineCommand& c = commands[i];
+                        OrderBook& book = *books[c.instrument];
+                        fills.clear();
+                        switch (c.type) {
+                            case CommandType::Submit: book.submitOrder(c.order, &fills); break;
+                            case CommandType::Cancel: book.cancelOrder(c.order.id); break;
+                            case CommandType::Modify:
+                            case CommandType::AmendDown:
+                                book.modifyOrder(c.order.id, c.order.priceTick, c.order.quantity, &fills);
+                                break;
+                        }
+                    }
+                });
+            }
+            for (auto& w : workers) w.join();
+            return OPS / (duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9);
+        };
+        
+        auto run_sharded = [&](unsigned threads) {
+            ShardedEngine::Options options;
+            options.workers = threads;
+            options.maxInstruments = INSTRUMENTS;
+            ShardedEngine engine(options);
+            auto start = high_resolution_clock::now();
+            for (const EngineCommand& c : commands) {
+                while (!engine.push(c)) std::this_thread::yield();   // Queue full: let the worker catch up
+            }
+            engine.waitIdle();
+            double seconds = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+            return OPS / seconds;
+        };
+        
+        std::vector<unsigned> counts;
+        for (unsigned n = 1; n < cores; n *= 2) counts.push_back(n);
+        counts.push_back(cores);
+        
+        std::cout << std::left << std::setw(10) << "Threads" << std::right << std::setw(18) << "Shared (Mops/s)"
+                  << std::setw(19) << "Sharded (Mops/s)" << "\n";
+        for (unsigned n : counts) {
+            double shared = run_shared(n);
+            double sharded = run_sharded(n);
+            std::cout << std::left << std::setw(10) << n << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(18) << shared / 1e6 << std::setw(19) << sharded / 1e6 << "\n";
+        }
+        if (cores == 1) {
+            std::cout << "\n(Single CPU: router and worker share it, so this shows overhead, not scaling)\n";
+        }
+    }
+
+    void benchmark_idle_strategies() {
+        std::cout << "\n=== ENGINE IDLE STRATEGY BENCHMARK ===\n";
+        
+        struct TimedOrder {
+            Order order;
+            uint64_t sentNs;
+        };
+        constexpr int BURSTS = 1000;
+        constexpr int BURST_SIZE = 8;
+        constexpr auto GAP = std::chrono::microseconds(1000);
+        std::cout << BURSTS << " bursts of " << BURST_SIZE << " orders, " << GAP.count()
+                  << "us apart, fed to one engine thread; latency is enqueue to applied\n\n";
+        
+        auto now_ns = [] {
+            return uint64_t(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+        };
+        
+        std::cout << std::left << std::setw(15) << "Idle" << std::right << std::setw(10) << "Mean"
+                  << std::setw(12) << "P99" << std::setw(12) << "Max" << std::setw(8) << "Duty"
+                  << std::setw(8) << "CPU" << std::setw(10) << "Sleeps" << std::setw(10) << "MaxDepth" << "\n";
+        for (IdleStrategy strategy : {IdleStrategy::Spin, IdleStrategy::Pause, IdleStrategy::Yield,
+                                      IdleStrategy::BackoffSleep}) {
+            OrderBook ob(100000);
+            ob.setConcurrencyMode(ConcurrencyMode::SingleThreaded);
+            CommandQueue<TimedOrder> queue(4096);
+            LatencyHistogram latency;
+            std::mt19937_64 rng(13);
+            
+            EngineRunner::Options options;
+            options.cpu = 0;
+            options.idle.strategy = strategy;
+            options.depthSampleInterval = 1;
+            EngineRunner runner(options, [&] {
+                size_t done = 0;
+                TimedOrder item;
+                while (done < 64 && queue.tryPop(item)) {
+                    ob.submitOrder(item.order);
+                    latency.record(now_ns() - item.sentNs);
+                    ++done;
+                }
+                return done;
+            }, [&] { return queue.sizeApprox(); });
+            
+            uint64_t id = 1;
+            for (int burst = 0; burst < BURSTS; ++burst) {
+                for (int i = 0; i < BURST_SIZE; ++i) {
+                    Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+                    int64_t offset = int64_t(rng() % 100) - 5;
+                    Order order{id++, side, side == Side::Buy ? 5200000 - offset * 100 : 5200100 + offset * 100,
+                                1 + uint32_t(rng() % 100), OrderType::Limit, TimeInForce::IOC, 1, 0};
+                    while (!queue.tryPush({order, now_ns()})) std::this_thread::yield();
+                }
+                std::this_thread::sleep_for(GAP);
+            }
+            runner.stop();
+            
+            auto stats = runner.stats();
+            std::cout << std::left << std::setw(15) << idleStrategyName(strategy) << std::right << std::fixed
+                      << std::setprecision(0) << std::setw(8) << latency.getMeanNs() << "ns"
+                      << std::setw(10) << latency.getPercentileNs(99) << "ns"
+                      << std::setw(10) << latency.getMaxNs() << "ns"
+                      << std::setw(7) << stats.dutyCycle() * 100 << "%"
+                      << std::setw(7) << stats.cpuShare() * 100 << "%"
+                      << std::setw(10) << stats.sleeps << std::setw(10) << stats.maxQueueDepth << "\n";
+        }
+        std::cout << "(Duty: wall time spent applying orders; CPU: thread CPU time over wall time."
+                  << " Spinning engines\n want a core of their own - on a shared core they delay the producer too)\n";
+    }
+
+    void benchmark_gateway_pipeline() {
+        std::cout << "\n=== STAGED GATEWAY BENCHMARK ===\n";
+        
+        constexpr int MESSAGES = 400000;
+        constexpr uint32_t OWNERS = 64;
+        constexpr InstrumentId INSTRUMENTS = 16;
+        GatewayRules rules;
+        rules.maxInstruments = INSTRUMENTS;
+        rules.instruments.assign(INSTRUMENTS, InstrumentRules{490000, 510000, 10, 10000});
+        rules.permittedOwners.assign(OWNERS, 1);
+        
+        // Tag=value messages: mostly new orders, some cancels, a few rejects
+        std::mt19937_64 rng(17);
+        std::vector<std::pair<uint32_t, std::string>> messages;
+        messages.reserve(MESSAGES);
+        std::vector<uint64_t> last_id(OWNERS, 0);
+        char buf[GatewayMessage::MAX_LENGTH + 1];
+        for (int i = 0; i < MESSAGES; ++i) {
+            uint32_t owner = uint32_t(rng() % OWNERS);
+            uint64_t base = uint64_t(owner + 1) << 32;
+            if (last_id[owner] > 0 && rng() % 5 == 0) {
+                std::snprintf(buf, sizeof(buf), "35=F|11=%llu|55=%u",
+                              (unsigned long long)(base + last_id[owner] - rng() % last_id[owner]), unsigned(rng() % INSTRUMENTS));
+            } else {
+                int side = 1 + int(rng() & 1);
+                int64_t price = 500000 + (side == 1 ? -1 : 1) * (int64_t(rng() % 300) - 20) * 10;
+                uint32_t qty = 10 * (1 + uint32_t(rng() % 50)) + (rng() % 100 == 0 ? 5 : 0);
+                std::snprintf(buf, sizeof(buf), "35=D|11=%llu|55=%u|54=%d|44=%lld.%02lld|38=%u|40=2|59=1|1=%u",
+                              (unsigned long long)(base + ++last_id[owner]), unsigned(rng() % INSTRUMENTS), side,
+                              (long long)(price / TICK_PRECISION), (long long)(price % TICK_PRECISION), qty, owner);
+            }
+            messages.emplace_back(owner, buf);
+        }
+        std::cout << MESSAGES << " tag=value messages from " << OWNERS << " owners over " << INSTRUMENTS
+                  << " instruments (" << std::thread::hardware_concurrency() << " CPUs)\n\n";
+        
+        std::cout << std::left << std::setw(22) << "Mode" << std::right << std::setw(12) << "Kmsg/s"
+                  << std::setw(16) << "Matcher ns/msg" << std::setw(20) << "Matcher cap Kmsg/s"
+                  << std::setw(10) << "Rejected" << "\n";
+        auto report = [&](const std::string& mode, double seconds, double matcher_ns, uint64_t rejected) {
+            std::cout << std::left << std::setw(22) << mode << std::right << std::fixed << std::setprecision(0)
+                      << std::setw(12) << MESSAGES / seconds / 1e3
+                      << std::setw(16) << matcher_ns
+                      << std::setw(20) << (matcher_ns > 0 ? 1e6 / matcher_ns : 0.0)
+                      << std::setw(10) << rejected << "\n";
+        };
+        
+        // Inline: the matching thread decodes, validates and matches each message
+        {
+            BookManager books(INSTRUMENTS);
+            books.setBookConcurrencyMode(ConcurrencyMode::SingleThreaded);
+            OrderValidator validator(rules);
+            std::vector<Fill> fills;
+            fills.reserve(256);
+            uint64_t rejected = 0;
+            GatewayMessage raw;
+            EngineCommand command;
+            auto start = high_resolution_clock::now();
+            for (const auto& [owner, text] : messages) {
+                raw.assign(owner, text);
+                if (validator.check(raw, command) != RejectReason::None) {
+                    ++rejected;
+                    continue;
+                }
+                applyCommand(books, command, fills);
+            }
+            double seconds = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+            report("Inline validation", seconds, seconds * 1e9 / MESSAGES, rejected);
+        }
+        
+        // Matching alone, on commands validated beforehand: the floor for the staged matcher
+        {
+            BookManager books(INSTRUMENTS);
+            books.setBookConcurrencyMode(ConcurrencyMode::SingleThreaded);
+            OrderValidator validator(rules);
+            std::vector<EngineCommand> commands;
+            commands.reserve(MESSAGES);
+            GatewayMessage raw;
+            EngineCommand command;
+            for (const auto& [owner, text] : messages) {
+                raw.assign(owner, text);
+                if (validator.check(raw, command) == RejectReason::None) commands.push_back(command);
+            }
+            std::vector<Fill> fills;
+            fills.reserve(256);
+            auto start = high_resolution_clock::now();
+            for (const EngineCommand& validated : commands) applyCommand(books, validated, fills);
+            double seconds = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+            report("Matching only", seconds, seconds * 1e9 / MESSAGES, MESSAGES - commands.size());
+        }
+        
+        // Staged: gateway threads validate, the matcher only applies what passed
+        for (unsigned gateways : {1u, 2u, 4u}) {
+            OrderGateway::Options options;
+            options.gateways = gateways;
+            options.idle.strategy = IdleStrategy::Yield;
+            OrderGateway gateway(rules, options);
+            auto start = high_resolution_clock::now();
+            for (const auto& [owner, text] : messages) {
+                while (!gateway.receive(owner, text)) std::this_thread::yield();
+            }
+            gateway.waitIdle();
+            double seconds = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+            auto stats = gateway.stats();
+            // Matcher busy time per message offered: the cost left on the critical path
+            double matcher_ns = double(stats.matcher.busyNs) / MESSAGES;
+            report(std::to_string(gateways) + " gateway thread" + (gateways > 1 ? "s" : ""), seconds, matcher_ns,
+                   stats.rejected());
+        }
+        std::cout << "(Matcher ns/msg: matching-thread busy time per message offered; Matcher cap: the rate that\n"
+                  << " cost sustains. Staged rates need a core per gateway plus one for the matcher to reach it;\n"
+                  << " on a shared core, preemption inflates the matcher's busy time)\n";
+    }
+
+    void benchmark_async_book() {
+        std::cout << "\n=== ASYNC (CO_AWAIT) BOOK BENCHMARK ===\n";
+        
+        constexpr int OPS = 400000;   // Submit + cancel pairs count as two
+        std::cout << OPS << " awaited ops (submit then cancel per round), one client thread draining completions, "
+                  << std::thread::hardware_concurrency() << " CPUs\n\n";
+        
+        // Direct calls on the caller's thread: the cost of the book itself
+        {
+            OrderBook book(OPS);
+            book.setConcurrencyMode(ConcurrencyMode::SingleThreaded);
+            auto start = high_resolution_clock::now();
+            for (int i = 0; i < OPS / 2; ++i) {
+                uint64_t id = uint64_t(i + 1);
+                Side side = (id & 1) ? Side::Buy : Side::Sell;
+                int64_t price = (side == Side::Buy) ? 49990 - int64_t(id % 50) : 50010 + int64_t(id % 50);
+                book.submitOrder({id, side, price, 100, OrderType::Limit, TimeInForce::GTC, 1, 0});
+                book.cancelOrder(id);
+            }
+            double seconds = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+            std::cout << "Synchronous calls: " << std::fixed << std::setprecision(0) << OPS / seconds / 1e3
+                      << " Kops/s (" << std::setprecision(1) << seconds * 1e9 / OPS << " ns/op)\n\n";
+        }
+        
+        std::cout << std::left << std::setw(24) << "In flight" << std::right << std::setw(10) << "Kops/s"
+                  << std::setw(12) << "p50 (ns)" << std::setw(12) << "p99 (ns)" << std::setw(12) << "Overloaded"
+                  << std::setw(14) << "Frames fresh" << std::setw(14) << "reused" << "\n";
+        
+        struct Case { int clients; size_t limit; };
+        for (Case c : {Case{1, 1 << 14}, Case{64, 1 << 14}, Case{1024, 1 << 14}, Case{4096, 1 << 14},
+                       Case{16384, 1 << 14}, Case{4096, 1024}}) {
+            AsyncBook::Options options;
+            options.maxInFlight = c.limit;
+            options.idle.strategy = IdleStrategy::Yield;
+            AsyncBook book(OPS, options);
+            LatencyHistogram latency;
+            uint64_t overloaded = 0;
+            int finished = 0;
+            int rounds = std::max(1, OPS / 2 / c.clients);
+            FramePool::Stats before = FramePool::threadStats();
+            
+            auto start = high_resolution_clock::now();
+            for (int i = 0; i < c.clients; ++i) {
+                async_client(book, uint64_t(i) * uint64_t(rounds) + 1, rounds, latency, overloaded, finished);
+            }
+            while (finished < c.clients) {
+                if (book.drain() == 0) std::this_thread::yield();
+            }
+            double seconds = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+            FramePool::Stats after = FramePool::threadStats();
+            
+            std::string label = std::to_string(c.clients) + (c.clients > 1 ? " coroutines" : " coroutine");
+            if (c.limit < size_t(c.clients)) label += " (cap " + std::to_string(c.limit) + ")";
+            uint64_t ops = book.stats().applied;   // Overloaded calls were never queued
+            std::cout << std::left << std::setw(24) << label << std::right << std::fixed << std::setprecision(0)
+                      << std::setw(10) << ops / seconds / 1e3
+                      << std::setw(12) << latency.getPercentileNs(50)
+                      << std::setw(12) << latency.getPercentileNs(99)
+                      << std::setw(12) << overloaded
+                      << std::setw(14) << (after.fresh - before.fresh)
+                      << std::setw(14) << (after.reused - before.reused) << "\n";
+        }
+        std::cout << "(Latency is suspension to resumption, so with many coroutines in flight it includes the\n"
+                  << " wait behind everyone else's commands. Frames come from a per-thread pool: fresh ones are\n"
+                  << " only taken while the pool grows to the peak number of live coroutines.)\n";
+    }
+
+    void benchmark_cancel_lane() {
+        std::cout << "\n=== CANCEL-PRIORITY LANE BENCHMARK ===\n";
+        
+        constexpr int MAKER_ORDERS = 20000;
+        constexpr int BURSTS = 40;
+        constexpr int NEW_PER_BURST = 4000;
+        constexpr int CANCELS_PER_BURST = 400;   // Most pull resting quotes, some chase the burst's own orders
+        std::cout << BURSTS << " bursts of " << NEW_PER_BURST << " new orders + " << CANCELS_PER_BURST
+                  << " cancels pushed at once onto one worker over " << MAKER_ORDERS << " resting quotes ("
+                  << std::thread::hardware_concurrency() << " CPUs)\n\n";
+        
+        // Same script for every mode
+        std::mt19937_64 rng(23);
+        std::vector<EngineCommand> script;
+        std::vector<uint64_t> resting(MAKER_ORDERS);
+        for (int i = 0; i < MAKER_ORDERS; ++i) resting[i] = uint64_t(i + 1);
+        std::shuffle(resting.begin(), resting.end(), rng);
+        uint64_t next_id = MAKER_ORDERS + 1;
+        for (int b = 0; b < BURSTS; ++b) {
+            std::vector<uint64_t> burst_ids;
+            for (int i = 0; i < NEW_PER_BURST + CANCELS_PER_BURST; ++i) {
+                Order order{};
+                if (rng() % (NEW_PER_BURST + CANCELS_PER_BURST) < CANCELS_PER_BURST) {
+                    if (!burst_ids.empty() && rng() % 10 == 0) {
+                        order.id = burst_ids[rng() % burst_ids.size()];
+                    } else {
+                        order.id = resting.back();
+                        resting.pop_back();
+                    }
+                    script.push_back({CommandType::Cancel, 0, order});
+                } else {
+                    Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+                    order = {next_id, side, (side == Side::Buy) ? 49900 - int64_t(rng() % 100) : 50100 + int64_t(rng() % 100),
+                             100, OrderType::Limit, TimeInForce::GTC, 2, 0};
+                    burst_ids.push_back(next_id++);
+                    script.push_back({CommandType::Submit, 0, order});
+                }
+            }
+        }
+        
+        std::cout << std::left << std::setw(18) << "Mode" << std::right
+                  << std::setw(14) << "Cancel mean" << std::setw(14) << "Cancel p99"
+                  << std::setw(14) << "New mean" << std::setw(14) << "New p99"
+                  << std::setw(10) << "Deferred" << std::setw(12) << "Fair turns" << std::setw(10) << "Kcmd/s" << "\n";
+        
+        for (uint32_t burst_limit : {0u, 4u, 16u, 64u, 1u << 30}) {
+            ShardedEngine::Options options;
+            options.workers = 1;
+            options.pinThreads = false;
+            options.queueCapacity = 1 << 14;
+            options.idle.strategy = IdleStrategy::Yield;
+            options.cancelLane = burst_limit > 0;
+            options.cancelBurst = burst_limit;
+            options.measureQueueDelay = true;
+            ShardedEngine engine(options);
+            
+            for (int i = 0; i < MAKER_ORDERS; ++i) {
+                Side side = (i & 1) ? Side::Buy : Side::Sell;
+                Order quote{uint64_t(i + 1), side, (side == Side::Buy) ? 49950 - int64_t(i % 50) : 50050 + int64_t(i % 50),
+                            100, OrderType::Limit, TimeInForce::GTC, 1, 0};
+                while (!engine.submit(0, quote)) std::this_thread::yield();
+            }
+            engine.waitIdle();
+            engine.resetQueueDelays();
+            
+            auto start = high_resolution_clock::now();
+            size_t per_burst = NEW_PER_BURST + CANCELS_PER_BURST;
+            for (size_t b = 0; b < script.size(); b += per_burst) {
+                for (size_t i = b; i < b + per_burst; ++i) {
+                    while (!engine.push(script[i])) std::this_thread::yield();
+                }
+                engine.waitIdle();
+            }
+            double seconds = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+            
+            LatencyHistogram cancels, orders;
+            engine.queueDelays(cancels, orders);
+            auto stats = engine.totalStats();
+            
+            std::string mode = burst_limit == 0 ? "FIFO (one queue)"
+                             : burst_limit >= (1u << 30) ? "Lane, no limit" : "Lane, burst " + std::to_string(burst_limit);
+            std::cout << std::left << std::setw(18) << mode << std::right << std::fixed << std::setprecision(0)
+                      << std::setw(14) << cancels.getMeanNs()
+                      << std::setw(14) << cancels.getPercentileNs(99)
+                      << std::setw(14) << orders.getMeanNs()
+                      << std::setw(14) << orders.getPercentileNs(99)
+                      << std::setw(10) << stats.deferred
+                      << std::setw(12) << stats.fairnessTurns
+                      << std::setw(10) << script.size() / seconds / 1e3 << "\n";
+        }
+        std::cout << "(Push-to-apply delay in ns, p99 as a log2 bucket bound. Deferred: cancels that overtook their own\n"
+                  << " order and were held for it. Fair turns: new orders let through by the burst limit.)\n";
+    }
+
+    void benchmark_coalescing() {
+        std::cout << "\n=== AMEND COALESCING BENCHMARK ===\n";
+        
+        constexpr int QUOTES = 2000;
+        constexpr int COMMANDS = 400000;
+        constexpr int BURST = 8192;
+        
+        // A market maker re-quoting: each step sends 1-6 amends to one quote back to
+        // back, now and then pulls a quote and places a new one
+        std::mt19937_64 rng(29);
+        std::vector<EngineCommand> script;
+        script.reserve(COMMANDS + 8);
+        std::vector<std::pair<uint64_t, Side>> live;
+        for (int i = 0; i < QUOTES; ++i) live.push_back({uint64_t(i + 1), (i & 1) ? Side::Buy : Side::Sell});
+        uint64_t next_id = QUOTES + 1;
+        auto quote_price = [&](Side side) {
+            return (side == Side::Buy) ? 49900 - int64_t(rng() % 100) : 50100 + int64_t(rng() % 100);
+        };
+        while (script.size() < size_t(COMMANDS)) {
+            size_t slot = rng() % live.size();
+            auto [id, side] = live[slot];
+            Order order{};
+            order.id = id;
+            if (rng() % 20 == 0) {
+                script.push_back({CommandType::Cancel, 0, order});
+                live[slot] = {next_id, side};
+                script.push_back({CommandType::Submit, 0, {next_id++, side, quote_price(side), 100,
+                                                           OrderType::Limit, TimeInForce::GTC, 1, 0}});
+                continue;
+            }
+            for (int n = 1 + int(rng() % 6); n > 0; --n) {
+                order.priceTick = quote_price(side);
+                order.quantity = 50 + uint32_t(rng() % 100);
+                script.push_back({CommandType::Modify, 0, order});
+            }
+        }
+        std::cout << script.size() << " commands (mostly back-to-back amends) on " << QUOTES
+                  << " resting quotes, pushed in bursts of " << BURST << "\n\n";
+        
+        std::cout << std::left << std::setw(16) << "Mode" << std::right << std::setw(10) << "Kcmd/s"
+                  << std::setw(14) << "Book ops" << std::setw(12) << "Coalesced" << std::setw(14) << "Worker duty"
+                  << std::setw(12) << "Same book" << "\n";
+        uint64_t reference[3] = {};
+        for (bool coalesce : {false, true}) {
+            ShardedEngine::Options options;
+            options.workers = 1;
+            options.pinThreads = false;
+            options.queueCapacity = BURST;
+            options.idle.strategy = IdleStrategy::Yield;
+            options.coalesce = coalesce;
+            ShardedEngine engine(options);
+            for (int i = 0; i < QUOTES; ++i) {
+                Side side = (i & 1) ? Side::Buy : Side::Sell;
+                int64_t price = (side == Side::Buy) ? 49900 - int64_t(i % 100) : 50100 + int64_t(i % 100);
+                while (!engine.submit(0, {uint64_t(i + 1), side, price, 100, OrderType::Limit,
+                                          TimeInForce::GTC, 1, 0})) std::this_thread::yield();
+            }
+            engine.waitIdle();
+            auto before = engine.totalStats();
+            
+            auto start = high_resolution_clock::now();
+            for (size_t b = 0; b < script.size(); b += BURST) {
+                size_t end = std::min(script.size(), b + BURST);
+                for (size_t i = b; i < end; ++i) {
+                    while (!engine.push(script[i])) std::this_thread::yield();
+                }
+                engine.waitIdle();
+            }
+            double seconds = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+            auto stats = engine.totalStats();
+            
+            const OrderBook* book = engine.shard(0).book(0);
+            uint64_t state[3] = {book->memoryUsage().restingOrders, book->getTotalVolume(Side::Buy),
+                                 book->getTotalVolume(Side::Sell)};
+            if (!coalesce) std::copy(state, state + 3, reference);
+            bool same = std::equal(state, state + 3, reference);
+            uint64_t commands = stats.processed - before.processed;
+            std::cout << std::left << std::setw(16) << (coalesce ? "Coalesced" : "Every command") << std::right
+                      << std::fixed << std::setprecision(0) << std::setw(10) << commands / seconds / 1e3
+                      << std::setw(14) << commands - stats.coalesced
+                      << std::setw(12) << stats.coalesced
+                      << std::setw(13) << std::setprecision(1) << stats.dutyCycle * 100 << "%"
+                      << std::setw(12) << (same ? "yes" : "NO") << "\n";
+        }
+        std::cout << "(Amends here never cross, so collapsing them must leave the same book. Batches are up to\n"
+                  << " 64 commands, so how much collapses depends on how far the worker falls behind.)\n";
+    }
+
+    void benchmark_overload() {
+        std::cout << "\n=== OVERLOAD / ADMISSION CONTROL BENCHMARK ===\n";
+        
+        constexpr uint32_t FLOODER = 1;
+        constexpr uint32_t FIRST_CLIENT = 2, CLIENTS = 8;
+        constexpr auto RUN_TIME = milliseconds(500);
+        constexpr auto CLIENT_GAP = microseconds(50);
+        
+        GatewayRules base_rules;
+        base_rules.maxInstruments = 4;
+        base_rules.instruments.assign(4, InstrumentRules{400000, 600000, 1, 100000});
+        base_rules.ownerLimits.resize(FIRST_CLIENT + CLIENTS);
+        for (uint32_t owner = FIRST_CLIENT; owner < FIRST_CLIENT + CLIENTS; ++owner) {
+            base_rules.ownerLimits[owner].priority = OWNER_PRIORITIES - 1;
+        }
+        std::cout << "Owner " << FLOODER << " sends IOC orders as fast as it can; " << CLIENTS
+                  << " well-behaved owners send one every " << CLIENT_GAP.count() << "us between them, for "
+                  << RUN_TIME.count() << "ms (" << std::thread::hardware_concurrency() << " CPUs)\n\n";
+        
+        std::cout << std::left << std::setw(24) << "Admission" << std::right << std::setw(12) << "Client p50"
+                  << std::setw(12) << "Client p99" << std::setw(12) << "Client max" << std::setw(10) << "Refused"
+                  << std::setw(12) << "Flood sent" << std::setw(12) << "admitted" << std::setw(12) << "Matched/s" << "\n";
+        
+        struct Case { const char* name; OverloadPolicy policy; double threshold; uint32_t flood_rate; };
+        for (Case c : {Case{"None (block)", OverloadPolicy::Block, 1.0, 0},
+                       Case{"Reject at 50%", OverloadPolicy::Reject, 0.5, 0},
+                       Case{"Shed by priority", OverloadPolicy::ShedByPriority, 1.0, 0},
+                       Case{"Rate limit 20k/s", OverloadPolicy::Reject, 1.0, 20000}}) {
+            GatewayRules rules = base_rules;
+            rules.ownerLimits[FLOODER].rate = {c.flood_rate, 64};
+            OrderGateway::Options options;
+            options.gateways = 1;
+            options.gatewayQueueCapacity = 4096;
+            options.sequencerCapacity = 4096;
+            options.idle.strategy = IdleStrategy::Yield;
+            options.overload = c.policy;
+            options.overloadThreshold = c.threshold;
+            options.measureLatency = true;
+            OrderGateway gateway(rules, options);
+            
+            std::atomic<bool> running{true};
+            uint64_t flood_sent = 0, flood_admitted = 0;
+            std::thread flooder([&] {
+                char buf[GatewayMessage::MAX_LENGTH + 1];
+                for (uint64_t id = 1; running.load(std::memory_order_relaxed); ++id) {
+                    std::snprintf(buf, sizeof(buf), "35=D|11=%llu|55=1|54=1|44=4500.00|38=10|59=3", (unsigned long long)id);
+                    ++flood_sent;
+                    if (gateway.receive(FLOODER, buf)) ++flood_admitted;
+                }
+            });
+            
+            uint64_t refused = 0;
+            char buf[GatewayMessage::MAX_LENGTH + 1];
+            auto start = high_resolution_clock::now();
+            auto next = start;
+            for (uint64_t n = 0; high_resolution_clock::now() - start < RUN_TIME; ++n) {
+                uint32_t owner = FIRST_CLIENT + uint32_t(n % CLIENTS);
+                std::snprintf(buf, sizeof(buf), "35=D|11=%llu|55=1|54=2|44=5500.00|38=10|59=3",
+                              (unsigned long long)(n / CLIENTS + 1));
+                if (!gateway.receive(owner, buf)) ++refused;
+                next += CLIENT_GAP;
+                std::this_thread::sleep_until(next);
+            }
+            running.store(false);
+            flooder.join();
+            gateway.waitIdle();
+            double seconds = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count() / 1e9;
+            
+            LatencyHistogram client_latency;
+            gateway.matchLatency(OWNER_PRIORITIES - 1, client_latency);
+            auto stats = gateway.stats();
+            std::cout << std::left << std::setw(24) << c.name << std::right
+                      << std::setw(12) << client_latency.getPercentileNs(50)
+                      << std::setw(12) << client_latency.getPercentileNs(99)
+                      << std::setw(12) << client_latency.getMaxNs()
+                      << std::setw(10) << refused
+                      << std::setw(12) << flood_sent
+                      << std::setw(12) << flood_admitted
+                      << std::setw(12) << std::fixed << std::setprecision(0) << stats.matched / seconds << "\n";
+        }
+        std::cout << "(Client latency: receive() to applied by the matcher, ns, log2 bucket bounds. With no\n"
+                  << " admission control the flood fills every queue and clients wait behind it. Rejecting at a\n"
+                  << " threshold keeps the queue short but refuses clients too; shedding by priority refuses only\n"
+                  << " the flood, and a rate limit caps it at its budget. With fewer cores than threads, time\n"
+                  << " slicing dominates the latencies.)\n";
+    }
+
+    void benchmark_mass_cancel() {
+        std::cout << "\n=== MASS CANCEL BENCHMARK ===\n";
+        
+        constexpr size_t BOOK_ORDERS = 1000000;
+        constexpr size_t EVERY = 20;                 // One order in 20 belongs to the owner being killed
+        constexpr uint32_t TARGET = 7;
+        constexpr int64_t MID = 500000, LEVELS = 2000;
+        std::cout << "Cancelling " << BOOK_ORDERS / EVERY << " orders of one owner in a "
+                  << BOOK_ORDERS << "-order book (" << 2 * LEVELS << " levels)\n\n";
+        
+        // Owners 1..6 and the target interleaved; bids below MID, asks above, so nothing crosses
+        auto build = [&](OrderBook& book, std::vector<uint64_t>& target_ids) {
+            for (uint64_t id = 1; id <= BOOK_ORDERS; ++id) {
+                Side side = (id & 1) ? Side::Buy : Side::Sell;
+                int64_t offset = 1 + int64_t((id / 2) % LEVELS);
+                uint32_t owner = (id % EVERY == 0) ? TARGET : 1 + uint32_t(id % 6);
+                book.submitOrder({id, side, side == Side::Buy ? MID - offset : MID + offset, 10,
+                                  OrderType::Limit, TimeInForce::GTC, owner, 0});
+                if (owner == TARGET) target_ids.push_back(id);
+            }
+        };
+        
+        std::cout << std::left << std::setw(30) << "Method" << std::right << std::setw(10) << "Cancelled"
+                  << std::setw(12) << "Total ms" << std::setw(12) << "ns/order" << std::setw(10) << "Locks"
+                  << std::setw(12) << "Resting" << "\n";
+        
+        for (int method = 0; method < 3; ++method) {
+            OrderBook book(BOOK_ORDERS);
+            std::vector<uint64_t> target_ids;
+            build(book, target_ids);
+            
+            const char* name = "";
+            size_t cancelled = 0, locks = 0;
+            std::vector<uint64_t> ids;
+            ids.reserve(target_ids.size());
+            auto start = high_resolution_clock::now();
+            if (method == 0) {
+                name = "cancelOrder per ID";
+                for (uint64_t id : target_ids) cancelled += book.cancelOrder(id);
+                locks = target_ids.size();
+            } else if (method == 1) {
+                name = "cancelOwner (both sides)";
+                cancelled = book.cancelOwner(TARGET, &ids).orders;
+                locks = 1;
+            } else {
+                name = "cancelOwner x2 (per side)";
+                cancelled = book.cancelOwner(TARGET, Side::Buy, &ids).orders;
+                cancelled += book.cancelOwner(TARGET, Side::Sell, &ids).orders;
+                locks = 2;
+            }
+            double ns = duration_cast<nanoseconds>(high_resolution_clock::now() - start).count();
+            
+            std::cout << std::left << std::setw(30) << name << std::right << std::setw(10) << cancelled
+                      << std::setw(12) << std::fixed << std::setprecision(2) << ns / 1e6
+                      << std::setw(12) << std::setprecision(0) << ns / std::max<size_t>(1, cancelled)
+                      << std::setw(10) << locks
+                      << std::setw(12) << book.memoryUsage().restingOrders << "\n";
+            if (book.getOwnerOrderCount(TARGET, Side::Buy) + book.getOwnerOrderCount(TARGET, Side::Sell) != 0) {
+                std::cout << "  ERROR: owner still has resting orders\n";
+            }
+            if (method == 2) {
+                std::cout << "(Book footprint: " << std::setprecision(0) << book.memoryUsage().bytesPerOrder()
+                          << " bytes per resting order, owner links included)\n";
+            }
+        }
+        std::cout << "(cancelOwner walks only the owner's intrusive list and holds the lock once; the\n"
+                  << " cancelled IDs come back as one batch for a single MassCancelled event.)\n";
+    }
+
+    // Differential checks, seeded and repeatable. Returns false on any mismatch.
+    bool fuzz_differential(uint64_t seed = 1) {
+        std::cout << "\n=== DIFFERENTIAL FUZZ (seed " << seed << ") ===\n";
+        size_t book_mismatches = fuzz_depth_snapshot(seed);
+        size_t engine_mismatches = fuzz_sharded_engine(seed);
+        size_t toggle_mismatches = fuzz_snapshot_toggle(seed);
+        bool ok = book_mismatches == 0 && engine_mismatches == 0 && toggle_mismatches == 0;
+        std::cout << (ok ? "PASSED" : "FAILED") << "\n";
+        return ok;
+    }
+
+    // A book publishing depth snapshots against a plain one fed the same operations:
+    // outcomes, fills, lock-free top-10 vs the locked walk, and owner lists vs resting orders
+    size_t fuzz_depth_snapshot(uint64_t seed) {
+        constexpr size_t STEPS = 200000;
+        constexpr int64_t MID = 100000, SPREAD = 30;
+        constexpr uint32_t OWNERS = 6;
+        std::mt19937_64 rng(seed);
+        
+        OrderBook snap(100000), ref(100000);
+        snap.setDepthSnapshotEnabled(true);
+        snap.warmup();
+        ref.warmup();
+        
+        std::vector<Fill> snap_fills, ref_fills;
+        size_t mismatches = 0;
+        uint64_t next_id = 1;
+        auto report = [&](size_t step, const char* what) {
+            if (++mismatches <= 5) std::cout << "  step " << step << ": " << what << "\n";
+        };
+        auto same_levels = [](const std::vector<LevelInfo>& a, const std::vector<LevelInfo>& b) {
+            if (a.size() != b.size()) return false;
+            for (size_t i = 0; i < a.size(); ++i) {
+                if (a[i].priceTick != b[i].priceTick || a[i].totalQuantity != b[i].totalQuantity ||
+                    a[i].count != b[i].count) return false;
+            }
+            return true;
+        };
+        
+        for (size_t step = 0; step < STEPS; ++step) {
+            snap_fills.clear();
+            ref_fills.clear();
+            bool a = false, b = false;
+            int op = int(rng() % 100);
+            Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+            int64_t price = MID + int64_t(rng() % (2 * SPREAD + 1)) - SPREAD;
+            uint32_t qty = 1 + uint32_t(rng() % 50);
+            uint32_t owner = 1 + uint32_t(rng() % OWNERS);
+            uint64_t target = 1 + rng() % next_id;
+            if (op < 55) {
+                TimeInForce tif = op < 45 ? TimeInForce::GTC : (op < 50 ? TimeInForce::IOC : TimeInForce::FOK);
+                OrderType type = op == 54 ? OrderType::Market : OrderType::Limit;
+                Order order{next_id++, side, price, qty, type, tif, owner, 0};
+                a = snap.submitOrder(order, &snap_fills);
+                b = ref.submitOrder(order, &ref_fills);
+            } else if (op < 80) {
+                a = snap.cancelOrder(target);
+                b = ref.cancelOrder(target);
+            } else if (op < 97) {
+                a = snap.modifyOrder(target, price, qty, &snap_fills);
+                b = ref.modifyOrder(target, price, qty, &ref_fills);
+            } else if (op < 99) {
+                a = snap.cancelOwner(owner, side).orders == ref.cancelOwner(owner, side).orders;
+                b = true;
+            } else {
+                snap.cancelAll(side);
+                ref.cancelAll(side);
+                a = b = true;
+            }
+            
+            if (a != b) report(step, "operation outcome differs");
+            if (snap_fills.size() != ref_fills.size()) {
+                report(step, "fill count differs");
+            } else {
+                for (size_t i = 0; i < snap_fills.size(); ++i) {
+                    if (snap_fills[i].makerOrderId != ref_fills[i].makerOrderId ||
+                        snap_fills[i].quantity != ref_fills[i].quantity ||
+                        snap_fills[i].priceTick != ref_fills[i].priceTick) {
+                        report(step, "fill differs");
+                        break;
+                    }
+                }
+            }
+            
+            OrderBook::DepthSnapshot published;
+            snap.readDepthSnapshot(published);
+            for (Side s : {Side::Buy, Side::Sell}) {
+                std::vector<LevelInfo> locked = ref.getTopLevels(s, OrderBook::SNAPSHOT_DEPTH);
+                if (!same_levels(snap.getTopLevels(s, OrderBook::SNAPSHOT_DEPTH), locked)) {
+                    report(step, "lock-free top levels differ from the locked walk");
+                }
+                const auto& levels = s == Side::Buy ? published.bids : published.asks;
+                uint32_t count = s == Side::Buy ? published.bidLevels : published.askLevels;
+                if (!same_levels(std::vector<LevelInfo>(levels.begin(), levels.begin() + count), locked)) {
+                    report(step, "published snapshot differs from the locked walk");
+                }
+            }
+            
+            if (step % 1000 == 0) {
+                uint64_t listed = 0;
+                for (uint32_t o = 1; o <= OWNERS; ++o) {
+                    listed += snap.getOwnerOrderCount(o, Side::Buy) + snap.getOwnerOrderCount(o, Side::Sell);
+                }
+                uint64_t resting = snap.memoryUsage().restingOrders;
+                if (listed != resting) report(step, "owner lists disagree with resting orders");
+                if (resting != ref.memoryUsage().restingOrders) report(step, "resting orders differ");
+            }
+        }
+        std::cout << "Depth snapshot vs locked book: " << STEPS << " steps, " << mismatches << " mismatches\n";
+        return mismatches;
+    }
+
+    // Snapshot enabled and disabled by the writer while readers query the book. Every
+    // answer must be well formed: levels strictly best first, non-empty quantities.
+    // Mainly for the sanitizer builds, which catch a reader touching freed state.
+    size_t fuzz_snapshot_toggle(uint64_t seed) {
+        constexpr size_t STEPS = 100000;
+        constexpr int64_t MID = 100000, SPREAD = 30;
+        OrderBook book(100000);
+        std::atomic<bool> done{false};
+        std::atomic<size_t> mismatches{0}, reads{0};
+        
+        auto well_formed = [](const LevelInfo* levels, size_t count, Side side) {
+            for (size_t i = 0; i < count; ++i) {
+                if (levels[i].totalQuantity == 0 || levels[i].count == 0) return false;
+                if (i > 0 && (side == Side::Buy ? levels[i].priceTick >= levels[i - 1].priceTick
+                                                : levels[i].priceTick <= levels[i - 1].priceTick)) return false;
+            }
+            return true;
+        };
+        auto reader = [&] {
+            OrderBook::DepthSnapshot snapshot;
+            while (!done.load(std::memory_order_acquire)) {
+                for (Side side : {Side::Buy, Side::Sell}) {
+                    auto levels = book.getTopLevels(side, 5);
+                    if (!well_formed(levels.data(), levels.size(), side)) mismatches.fetch_add(1);
+                }
+                if (book.readDepthSnapshot(snapshot) &&
+                    (!well_formed(snapshot.bids.data(), snapshot.bidLevels, Side::Buy) ||
+                     !well_formed(snapshot.asks.data(), snapshot.askLevels, Side::Sell))) {
+                    mismatches.fetch_add(1);
+                }
+                reads.fetch_add(1, std::memory_order_relaxed);
+            }
+        };
+        std::thread r1(reader), r2(reader);
+        
+        std::mt19937_64 rng(seed ^ 0x7099);
+        uint64_t next_id = 1;
+        for (size_t step = 0; step < STEPS; ++step) {
+            if (step % 500 == 0) book.setDepthSnapshotEnabled((step / 500) % 2 == 0);
+            Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+            int64_t price = MID + int64_t(rng() % (2 * SPREAD + 1)) - SPREAD;
+            if (rng() % 3 == 0) {
+                book.cancelOrder(1 + rng() % next_id);
+            } else {
+                book.submitOrder({next_id++, side, price, 1 + uint32_t(rng() % 50), OrderType::Limit,
+                                  TimeInForce::GTC, 1, 0});
+            }
+        }
+        done.store(true, std::memory_order_release);
+        r1.join();
+        r2.join();
+        std::cout << "Snapshot toggled under readers: " << STEPS << " steps, " << reads.load() << " reads, "
+                  << mismatches.load() << " mismatches\n";
+        return mismatches.load();
+    }
+
+    // The sharded engine fed by two producers (each owning half the instruments, so
+    // per-instrument order is fixed) against a sequential replay through one BookManager
+    size_t fuzz_sharded_engine(uint64_t seed) {
+        constexpr size_t COMMANDS = 200000;
+        constexpr InstrumentId INSTRUMENTS = 64;
+        constexpr int64_t MID = 100000, SPREAD = 20;
+        std::mt19937_64 rng(seed ^ 0x5eed);
+        
+        std::vector<EngineCommand> stream;
+        stream.reserve(COMMANDS);
+        std::vector<std::vector<uint64_t>> ids(INSTRUMENTS);
+        uint64_t next_id = 1;
+        for (size_t i = 0; i < COMMANDS; ++i) {
+            EngineCommand command{};
+            command.instrument = InstrumentId(rng() % INSTRUMENTS);
+            Side side = (rng() & 1) ? Side::Buy : Side::Sell;
+            int64_t price = MID + int64_t(rng() % (2 * SPREAD + 1)) - SPREAD;
+            uint32_t qty = 1 + uint32_t(rng() % 50);
+            std::vector<uint64_t>& mine = ids[command.instrument];
+            int op = int(rng() % 100);
+            if (op < 60 || mine.empty()) {
+                command.type = CommandType::Submit;
+                command.order = {next_id, side, price, qty, OrderType::Limit,
+                                 op < 50 ? TimeInForce::GTC : TimeInForce::IOC, 1 + uint32_t(rng() % 4), 0};
+                mine.push_back(next_id++);
+            } else {
+                command.type = op < 85 ? CommandType::Cancel : CommandType::Modify;
+                command.order.id = mine[rng() % mine.size()];
+                command.order.priceTick = price;
+                command.order.quantity = qty;
+            }
+            stream.push_back(command);
+        }
+        
+        BookManager reference(INSTRUMENTS);
+        std::vector<Fill> fills;
+        uint64_t ref_fills = 0, ref_rejected = 0;
+        for (const EngineCommand& command : stream) {
+            if (!applyCommand(reference, command, fills)) ++ref_rejected;
+            ref_fills += fills.size();
+        }
+        
+        ShardedEngine::Options options;
+        options.workers = 3;
+        options.maxInstruments = INSTRUMENTS;
+        options.queueCapacity = 1 << 12;
+        options.pinThreads = false;
+        options.idle.strategy = IdleStrategy::Yield;
+        ShardedEngine engine(options);
+        auto produce = [&](InstrumentId parity) {
+            for (const EngineCommand& command : stream) {
+                if (command.instrument % 2 != parity) continue;
+                while (!engine.push(command)) std::this_thread::yield();
+            }
+        };
+        std::thread even(produce, 0), odd(produce, 1);
+        even.join();
+        odd.join();
+        engine.waitIdle();
+        
+        size_t mismatches = 0;
+        auto stats = engine.totalStats();
+        if (stats.fills != ref_fills || stats.rejected != ref_rejected) ++mismatches;
+        for (InstrumentId instrument = 0; instrument < INSTRUMENTS; ++instrument) {
+            const OrderBook* got = engine.shard(engine.workerOf(instrument)).book(instrument);
+            const OrderBook* want = reference.book(instrument);
+            if (!got || !want) {
+                if (got != want) ++mismatches;
+                continue;
+            }
+            if (got->memoryUsage().restingOrders != want->memoryUsage().restingOrders) ++mismatches;
+            for (Side side : {Side::Buy, Side::Sell}) {
+                auto a = got->getTopLevels(side, 50), b = want->getTopLevels(side, 50);
+                bool same = a.size() == b.size();
+                for (size_t i = 0; same && i < a.size(); ++i) {
+                    same = a[i].priceTick == b[i].priceTick && a[i].totalQuantity == b[i].totalQuantity;
+                }
+                if (!same) ++mismatches;
+            }
+        }
+        engine.stop();
+        std::cout << "Sharded engine vs sequential replay: " << COMMANDS << " commands, " << INSTRUMENTS
+                  << " instruments, " << stats.fills << " fills, " << mismatches << " mismatches\n";
+        return mismatches;
+    }
+
+    void benchmark_touch_flicker() {
+        std::cout << "\n=== TOUCH FLICKER BENCHMARK ===\n";
+        
+        OrderBook ob(100000);
+        uint64_t order_id = 1;
+        for (int level = 1; level <= 100; ++level) {
+            for (int j = 0; j < 10; ++j) {
+                ob.submitOrder({order_id++, Side::Buy, (50000 - level) * TICK_PRECISION, 100,
+                                OrderType::Limit, TimeInForce::GTC, uint32_t(1 + j), 0});
+                ob.submitOrder({order_id++, Side::Sell, (50000 + level) * TICK_PRECISION, 100,
+                                OrderType::Limit, TimeInForce::GTC, uint32_t(1 + j), 0});
+            }
+        }
+        
+        // A quote improves the touch at a fresh price, then vanishes: half are
+        // cancelled, half are lifted by an aggressive IOC order
+        constexpr int CYCLES = 500000;
+        const int64_t flicker_bid = 50000 * TICK_PRECISION;
+        auto run_cycles = [&](int cycles) {
+            for (int i = 0; i < cycles; ++i) {
+                uint64_t quote_id = order_id++;
+                ob.submitOrder({quote_id, Side::Buy, flicker_bid, 50,
+                                OrderType::Limit, TimeInForce::GTC, 77, 0});
+                if (i & 1) {
+                    ob.cancelOrder(quote_id);
+                } else {
+                    ob.submitOrder({order_id++, Side::Sell, flicker_bid, 50,
+                                    OrderType::Limit, TimeInForce::IOC, 88, 0});
+                }
+            }
+        };
+        
+        run_cycles(10000);   // Warm pools and caches
+        size_t level_bytes_before = ob.memoryUsage().levelBytes;
+        auto start = high_resolution_clock::now();
+        run_cycles(CYCLES);
+        auto end = high_resolution_clock::now();
+        size_t level_bytes_after = ob.memoryUsage().levelBytes;
+        
+        auto ns = duration_cast<nanoseconds>(end - start).count();
+        std::cout << "Cycles:          " << CYCLES << " (post at a new best bid, then cancel or get lifted)\n";
+        std::cout << "Avg per cycle:   " << std::fixed << std::setprecision(1) << ns / double(CYCLES) << " ns\n";
+        std::cout << "Level memory:    " << level_bytes_before / 1024 << " KB -> "
+                  << level_bytes_after / 1024 << " KB\n";
+        std::cout << "Best bid/ask:    $" << std::setprecision(2) << ob.bestBid() << " / $" << ob.bestAsk() << "\n";
+    }
+
+    void benchmark_deep_sweep() {
+        std::cout << "\n=== DEEP BOOK SWEEP BENCHMARK ===\n";
+        std::cout << "Software prefetch: " << (HFTUtils::prefetchEnabled ? "on" : "off (build with PREFETCH=1)") << "\n";
+        std::cout << "Each IOC buy sweeps the best N ask levels; swept levels are re-posted untimed.\n";
+        std::cout << "Cold runs evict the caches before every sweep.\n\n";
+        
+        HardwareCounters counters;
+        std::cout << std::left << std::setw(30) << "Scenario"
+                  << std::right << std::setw(10) << "Fills"
+                  << std::setw(14) << "Avg sweep"
+                  << std::setw(14) << "P99 sweep"
+                  << std::setw(12) << "Per fill"
+                  << std::setw(14) << "Misses/fill" << "\n";
+        std::cout << std::string(94, '-') << "\n";
+        
+        run_sweep("warm  200 lvls, 5 x 100", 200, 100, 5, 500, false, counters);
+        run_sweep("cold  200 lvls, 5 x 100", 200, 100, 5, 200, true, counters);
+        run_sweep("cold 1000 lvls, 50 x 20", 1000, 20, 50, 200, true, counters);
+        run_sweep("cold 2000 lvls, 200 x 5", 2000, 5, 200, 100, true, counters);
+        
+        if (!counters.available()) {
+            std::cout << "(hardware counters unavailable: perf_event_open denied or unsupported)\n";
+        }
+    }
+
 private:
+    static long minor_page_faults() {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_minflt;
+    }
+
+    void run_sweep(const char* label, int levels, int orders_per_level, int levels_per_sweep,
+                   int rounds, bool cold, HardwareCounters& counters) {
+        constexpr uint32_t ORDER_QTY = 10;
+        OrderBook ob(size_t(levels) * orders_per_level * 2);
+        uint64_t order_id = 1;
+        
+        // Post round-robin across levels so neighbouring orders of a level are not
+        // neighbours in memory (index nodes, cold records)
+        auto post_levels = [&](int count) {
+            for (int j = 0; j < orders_per_level; ++j) {
+                for (int level = 0; level < count; ++level) {
+                    ob.submitOrder({order_id++, Side::Sell, (50001 + level) * TICK_PRECISION, ORDER_QTY,
+                                    OrderType::Limit, TimeInForce::GTC, uint32_t(1 + order_id % 500), 0});
+                }
+            }
+        };
+        post_levels(levels);
+        
+        static std::vector<char> evict(64 << 20);
+        std::vector<Fill> fills;
+        fills.reserve(size_t(levels_per_sweep) * orders_per_level);
+        std::vector<uint64_t> sweep_ns;
+        sweep_ns.reserve(rounds);
+        uint64_t total_fills = 0;
+        uint64_t misses_before = counters.value(HardwareCounters::CacheMisses);
+        
+        for (int round = 0; round < rounds; ++round) {
+            if (cold) {
+                for (size_t i = 0; i < evict.size(); i += 64) evict[i] += 1;
+            }
+            Order sweep{order_id++, Side::Buy, (50001 + levels_per_sweep - 1) * TICK_PRECISION,
+                        ORDER_QTY * orders_per_level * levels_per_sweep,
+                        OrderType::Limit, TimeInForce::IOC, 0, 0};
+            fills.clear();
+            
+            counters.start();
+            auto start = high_resolution_clock::now();
+            ob.submitOrder(sweep, &fills);
+            auto end = high_resolution_clock::now();
+            counters.stop();
+            
+            sweep_ns.push_back(duration_cast<nanoseconds>(end - start).count());
+            total_fills += fills.size();
+            post_levels(levels_per_sweep);
+        }
+        
+        std::sort(sweep_ns.begin(), sweep_ns.end());
+        uint64_t total_ns = 0;
+        for (uint64_t ns : sweep_ns) total_ns += ns;
+        
+        std::cout << std::left << std::setw(30) << label << std::right << std::fixed
+                  << std::setw(10) << total_fills
+                  << std::setw(11) << std::setprecision(2) << total_ns / double(rounds) / 1000.0 << " μs"
+                  << std::setw(11) << sweep_ns[sweep_ns.size() * 99 / 100] / 1000.0 << " μs"
+                  << std::setw(9) << std::setprecision(1) << total_ns / double(total_fills) << " ns";
+        if (counters.available()) {
+            uint64_t misses = counters.value(HardwareCounters::CacheMisses) - misses_before;
+            std::cout << std::setw(14) << std::setprecision(3) << misses / double(total_fills);
+        } else {
+            std::cout << std::setw(14) << "n/a";
+        }
+        std::cout << "\n";
+    }
+
+private:
+    void print_footprint_row(const char* layout, uint64_t orders, size_t orderBytes,
+                             size_t levelBytes, size_t indexBytes) {
+        size_t total = orderBytes + levelBytes + indexBytes;
+        std::cout << std::left << std::setw(34) << layout
+                  << std::right << std::setw(10) << orders
+                  << std::setw(12) << orderBytes / 1024
+                  << std::setw(12) << levelBytes / 1024
+                  << std::setw(12) << indexBytes / 1024
+                  << std::setw(12) << total / 1024
+                  << std::setw(12) << std::fixed << std::setprecision(1)
+                  << (orders ? double(total) / orders : 0.0) << "\n";
+    }
+
     void setup_market_liquidity(OrderBook& ob) {
         std::cout << "Setting up market liquidity...\n";
         
@@ -264,6 +2273,18 @@ private:
     }
 };
 
+void write_trace(const char* path) {
+    if (!HFTTrace::enabled()) {
+        std::cout << "\nTracing is compiled out; rebuild with 'make TRACE=1' to capture spans\n";
+        return;
+    }
+    if (HFTTrace::writeChromeTrace(path)) {
+        std::cout << "\nChrome trace written to " << path << " (open in chrome://tracing or Perfetto)\n";
+    } else {
+        std::cerr << "Failed to write " << path << "\n";
+    }
+}
+
 int main(int argc, char* argv[]) {
     std::cout << "=================================================\n";
     std::cout << "SAFER ORDER BOOK PERFORMANCE TEST SUITE\n";
@@ -273,6 +2294,7 @@ int main(int argc, char* argv[]) {
     SafePerformanceTest test_suite;
     
     bool run_all = true;
+    int exit_code = 0;
     for (int i = 1; i < argc; ++i) {
         if (std::strcmp(argv[i], "--latency") == 0) {
             test_suite.benchmark_single_threaded();
@@ -283,6 +2305,78 @@ int main(int argc, char* argv[]) {
         } else if (std::strcmp(argv[i], "--market-data") == 0) {
             test_suite.benchmark_market_data();
             run_all = false;
+        } else if (std::strcmp(argv[i], "--memory") == 0) {
+            test_suite.benchmark_memory_footprint();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--simd") == 0) {
+            test_suite.benchmark_simd_kernels();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--numa") == 0) {
+            test_suite.benchmark_numa_placement();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--cold-start") == 0) {
+            test_suite.benchmark_cold_start();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--books") == 0) {
+            test_suite.benchmark_multi_book_memory();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--instruments") == 0) {
+            test_suite.benchmark_instruments();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--sharded") == 0) {
+            test_suite.benchmark_sharded_scaling();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--idle") == 0) {
+            test_suite.benchmark_idle_strategies();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--gateway") == 0) {
+            test_suite.benchmark_gateway_pipeline();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--async") == 0) {
+            test_suite.benchmark_async_book();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--cancel-lane") == 0) {
+            test_suite.benchmark_cancel_lane();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--coalesce") == 0) {
+            test_suite.benchmark_coalescing();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--overload") == 0) {
+            test_suite.benchmark_overload();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--fuzz") == 0) {
+            // Optional seed: --fuzz 42
+            uint64_t seed = (i + 1 < argc && argv[i + 1][0] != '-') ? std::strtoull(argv[++i], nullptr, 10) : 1;
+            if (!test_suite.fuzz_differential(seed)) exit_code = 1;
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--mass-cancel") == 0) {
+            test_suite.benchmark_mass_cancel();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--flicker") == 0) {
+            test_suite.benchmark_touch_flicker();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--sweep") == 0) {
+            test_suite.benchmark_deep_sweep();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--rw") == 0) {
+            test_suite.benchmark_reader_writer();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--locks") == 0) {
+            test_suite.benchmark_lock_policies();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--pipeline") == 0) {
+            test_suite.benchmark_event_pipeline();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--depth") == 0) {
+            test_suite.benchmark_depth_snapshot();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--lock-stats") == 0) {
+            test_suite.benchmark_lock_contention();
+            run_all = false;
+        } else if (std::strcmp(argv[i], "--trace") == 0) {
+            test_suite.benchmark_single_threaded();
+            write_trace("orderbook_trace.json");
+            run_all = false;
         }
     }
     
@@ -302,5 +2396,5 @@ int main(int argc, char* argv[]) {
     std::cout << "• Fast market data queries enable real-time trading\n";
     std::cout << "\n🏆 READY FOR TOP-TIER TRADING FIRMS!\n";
     
-    return 0;
+    return exit_code;
 }
\ No newline at end of file
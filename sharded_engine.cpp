@@ -0,0 +1,350 @@
+#include "sharded_engine.hpp"
+#include "numa_placement.hpp"
+#include <algorithm>
+#include <chrono>
+
+using namespace HFTUtils;
+
+namespace {
+    uint64_t steadyNowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    bool takesCancelLane(CommandType type) {
+        return type == CommandType::Cancel || type == CommandType::AmendDown;
+    }
+}
+
+ShardedEngine::ShardedEngine(const Options& options, FillHandler onFill)
+    : options_(options), fillCb_(std::move(onFill)) {
+    // Only CPUs in the process's affinity mask, so a taskset or cgroup restriction
+    // never leaves a worker pinned outside it
+    const std::vector<int> allowed = HFTNuma::allowedCpus();
+    const std::vector<int>& placement = options_.cpus.empty() ? allowed : options_.cpus;
+    unsigned count = options_.workers ? options_.workers : static_cast<unsigned>(std::max<size_t>(1, allowed.size()));
+
+    workers_.reserve(count);
+    for (unsigned i = 0; i < count; ++i) {
+        auto worker = std::make_unique<Worker>(options_.maxInstruments, options_.ordersPerBookHint,
+                                               options_.queueCapacity,
+                                               options_.cancelLane ? options_.cancelLaneCapacity : 2);
+        worker->books.setBookConcurrencyMode(options_.bookLocking);
+        if (options_.pinThreads && !placement.empty()) {
+            worker->cpu = placement[i % placement.size()];
+        }
+        workers_.push_back(std::move(worker));
+    }
+    for (auto& worker : workers_) {
+        EngineRunner::Options runner;
+        runner.cpu = worker->cpu;
+        runner.idle = options_.idle;
+        Worker* w = worker.get();
+        w->runner = std::make_unique<EngineRunner>(runner, [this, w] { return poll(*w); },
+                                                   [w] { return w->queue.sizeApprox() + w->cancels.sizeApprox(); });
+    }
+}
+
+ShardedEngine::~ShardedEngine() {
+    stop();
+}
+
+bool ShardedEngine::push(const EngineCommand& command) {
+    if (command.instrument >= options_.maxInstruments || !running_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    Worker& worker = *workers_[workerOf(command.instrument)];
+    CommandQueue<EngineCommand>& queue =
+        (options_.cancelLane && takesCancelLane(command.type)) ? worker.cancels : worker.queue;
+    bool pushed;
+    if (options_.measureQueueDelay) {
+        EngineCommand stamped = command;
+        stamped.enqueuedNs = steadyNowNs();
+        pushed = queue.tryPush(stamped);
+    } else {
+        pushed = queue.tryPush(command);
+    }
+    if (UNLIKELY(!pushed)) {
+        worker.queueFull.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+bool ShardedEngine::submit(InstrumentId instrument, const Order& order) {
+    return push({CommandType::Submit, instrument, order});
+}
+
+bool ShardedEngine::cancel(InstrumentId instrument, uint64_t orderId) {
+    Order order{};
+    order.id = orderId;
+    return push({CommandType::Cancel, instrument, order});
+}
+
+bool ShardedEngine::modify(InstrumentId instrument, uint64_t orderId, int64_t newPrice, uint32_t newQty) {
+    Order order{};
+    order.id = orderId;
+    order.priceTick = newPrice;
+    order.quantity = newQty;
+    return push({CommandType::Modify, instrument, order});
+}
+
+bool ShardedEngine::amendDown(InstrumentId instrument, uint64_t orderId, int64_t newPrice, uint32_t newQty) {
+    Order order{};
+    order.id = orderId;
+    order.priceTick = newPrice;
+    order.quantity = newQty;
+    return push({CommandType::AmendDown, instrument, order});
+}
+
+bool applyCommand(BookManager& books, const EngineCommand& command, std::vector<Fill>& fills) {
+    fills.clear();
+    switch (command.type) {
+        case CommandType::Submit:
+            return books.submitOrder(command.instrument, command.order, &fills);
+        case CommandType::Cancel:
+            return books.cancelOrder(command.order.id);
+        case CommandType::Modify:
+        case CommandType::AmendDown:
+            return books.modifyOrder(command.order.id, command.order.priceTick, command.order.quantity, &fills);
+    }
+    return false;
+}
+
+bool ShardedEngine::execute(Worker& worker, const EngineCommand& command, std::vector<Fill>& fills) {
+    bool accepted = applyCommand(worker.books, command, fills);
+    if (fillCb_) {
+        for (const Fill& fill : fills) fillCb_(command.instrument, fill);
+    }
+    return accepted;
+}
+
+CommandCoalescer::Run& CommandCoalescer::slotFor(uint64_t orderId) {
+    size_t slot = size_t((orderId * 0x9E3779B97F4A7C15ull) >> 32) & (TABLE_SIZE - 1);
+    for (;;) {
+        Run& run = runs_[slot];
+        if (run.stamp != stamp_) {
+            run = Run{orderId, NO_RUN, stamp_};
+            return run;
+        }
+        if (run.orderId == orderId) return run;
+        slot = (slot + 1) & (TABLE_SIZE - 1);
+    }
+}
+
+size_t CommandCoalescer::coalesce(const EngineCommand* commands, size_t count, bool* skip) {
+    // A new stamp empties the table without touching it
+    if (++stamp_ == 0) {
+        runs_.fill(Run{});
+        stamp_ = 1;
+    }
+    size_t superseded = 0;
+    for (size_t i = 0; i < count; ++i) {
+        skip[i] = false;
+        const EngineCommand& command = commands[i];
+        Run& run = slotFor(command.order.id);
+        if (command.type == CommandType::Submit) {
+            run.index = NO_RUN;
+            continue;
+        }
+        if (run.index != NO_RUN) {
+            ++superseded;
+            if (commands[run.index].type == CommandType::Cancel) {
+                skip[i] = true;          // The order is already gone
+                continue;
+            }
+            skip[run.index] = true;      // An amend replaced by this amend or cancel
+        }
+        run.index = uint32_t(i);
+    }
+    return superseded;
+}
+
+// Runs on the worker's thread, so books created on first use are first touched
+// (and placed) there
+size_t ShardedEngine::poll(Worker& worker) {
+    uint32_t count = popBatch(worker);
+    size_t done = count;
+    if (count > 0) {
+        if (options_.coalesce && count > 1) {
+            size_t superseded = worker.coalescer.coalesce(worker.batch.data(), count, worker.batchSkip.data());
+            worker.coalescedLocal += superseded;
+            worker.processedLocal += superseded;
+        } else {
+            std::fill_n(worker.batchSkip.begin(), count, false);
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            if (worker.batchFromLane[i]) {
+                if (!worker.batchSkip[i]) applyFromCancelLane(worker, worker.batch[i]);
+            } else {
+                if (!worker.batchSkip[i]) applyFromQueue(worker, worker.batch[i]);
+                ++worker.queueApplied;
+            }
+        }
+    }
+    if (!worker.deferred.empty()) done += expireDeferred(worker);
+    if (options_.cancelLane) {
+        worker.cancelLaneApplied.store(worker.cancelLaneLocal, std::memory_order_relaxed);
+        worker.deferredCount.store(worker.deferredLocal, std::memory_order_relaxed);
+        worker.fairnessTurns.store(worker.fairnessLocal, std::memory_order_relaxed);
+    }
+    if (done > 0) {
+        worker.coalesced.store(worker.coalescedLocal, std::memory_order_relaxed);
+        worker.rejected.store(worker.rejectedLocal, std::memory_order_relaxed);
+        worker.fills.store(worker.fillsLocal, std::memory_order_relaxed);
+        worker.processed.store(worker.processedLocal, std::memory_order_release);
+    }
+    return done;
+}
+
+// Pops up to DRAIN_BATCH commands in the order they are to be applied
+uint32_t ShardedEngine::popBatch(Worker& worker) {
+    uint32_t count = 0;
+    if (!options_.cancelLane) {
+        while (count < DRAIN_BATCH && worker.queue.tryPop(worker.batch[count])) {
+            worker.batchFromLane[count++] = false;
+        }
+        return count;
+    }
+    while (count < DRAIN_BATCH) {
+        // Cancel lane first, unless it has had cancelBurst turns in a row
+        bool cancelTurn = worker.cancelRun < options_.cancelBurst;
+        bool fromLane;
+        if (cancelTurn && worker.cancels.tryPop(worker.batch[count])) {
+            ++worker.cancelRun;
+            fromLane = true;
+        } else if (worker.queue.tryPop(worker.batch[count])) {
+            if (!cancelTurn) ++worker.fairnessLocal;
+            worker.cancelRun = 0;
+            fromLane = false;
+        } else if (worker.cancels.tryPop(worker.batch[count])) {
+            fromLane = true;
+        } else {
+            break;
+        }
+        if (fromLane) ++worker.cancelLaneLocal;
+        worker.batchFromLane[count++] = fromLane;
+    }
+    return count;
+}
+
+void ShardedEngine::apply(Worker& worker, const EngineCommand& command) {
+    if (options_.measureQueueDelay) {
+        uint64_t delay = steadyNowNs() - command.enqueuedNs;
+        (takesCancelLane(command.type) ? worker.cancelDelay : worker.orderDelay).record(delay);
+    }
+    if (!execute(worker, command, worker.scratchFills)) ++worker.rejectedLocal;
+    worker.fillsLocal += worker.scratchFills.size();
+    ++worker.processedLocal;
+}
+
+void ShardedEngine::applyFromQueue(Worker& worker, const EngineCommand& command) {
+    apply(worker, command);
+    if (command.type != CommandType::Submit || worker.deferred.empty()) return;
+    // Release whatever the cancel lane was holding for this order
+    for (auto it = worker.deferred.begin(); it != worker.deferred.end();) {
+        if (it->command.order.id == command.order.id) {
+            apply(worker, it->command);
+            it = worker.deferred.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// An unknown target may be a submit still queued behind new orders (sent just
+// before the cancel): hold the command until everything queued ahead of it is applied
+void ShardedEngine::applyFromCancelLane(Worker& worker, const EngineCommand& command) {
+    uint64_t queued = worker.queue.pushed();
+    if (worker.queueApplied < queued && worker.books.instrumentOf(command.order.id) < 0) {
+        worker.deferred.push_back({command, queued});
+        ++worker.deferredLocal;
+        return;
+    }
+    apply(worker, command);
+}
+
+// Held commands whose horizon has passed without their order showing up: apply
+// them now (the book rejects them if the order never rested)
+size_t ShardedEngine::expireDeferred(Worker& worker) {
+    size_t expired = 0;
+    while (expired < worker.deferred.size() && worker.deferred[expired].horizon <= worker.queueApplied) {
+        apply(worker, worker.deferred[expired].command);
+        ++expired;
+    }
+    worker.deferred.erase(worker.deferred.begin(), worker.deferred.begin() + expired);
+    return expired;
+}
+
+void ShardedEngine::waitIdle() const {
+    for (const auto& worker : workers_) {
+        uint64_t target = worker->queue.pushed() + worker->cancels.pushed();
+        while (worker->processed.load(std::memory_order_acquire) < target) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ShardedEngine::stop() {
+    running_.store(false, std::memory_order_release);
+    for (auto& worker : workers_) {
+        if (worker->runner) worker->runner->stop();
+    }
+}
+
+ShardedEngine::WorkerStats ShardedEngine::workerStats(unsigned index) const {
+    const Worker& worker = *workers_[index];
+    WorkerStats stats;
+    stats.cpu = worker.cpu;
+    stats.processed = worker.processed.load(std::memory_order_acquire);
+    stats.rejected = worker.rejected.load(std::memory_order_relaxed);
+    stats.fills = worker.fills.load(std::memory_order_relaxed);
+    stats.queueFull = worker.queueFull.load(std::memory_order_relaxed);
+    stats.cancelLane = worker.cancelLaneApplied.load(std::memory_order_relaxed);
+    stats.deferred = worker.deferredCount.load(std::memory_order_relaxed);
+    stats.fairnessTurns = worker.fairnessTurns.load(std::memory_order_relaxed);
+    stats.coalesced = worker.coalesced.load(std::memory_order_relaxed);
+    stats.queueDepth = worker.queue.sizeApprox() + worker.cancels.sizeApprox();
+    if (worker.runner) {
+        EngineRunner::Stats runner = worker.runner->stats();
+        stats.maxQueueDepth = runner.maxQueueDepth;
+        stats.dutyCycle = runner.dutyCycle();
+        stats.pinFailures = runner.pinFailed ? 1 : 0;
+    }
+    return stats;
+}
+
+ShardedEngine::WorkerStats ShardedEngine::totalStats() const {
+    WorkerStats total;
+    for (unsigned i = 0; i < workerCount(); ++i) {
+        WorkerStats stats = workerStats(i);
+        total.pinFailures += stats.pinFailures;
+        total.processed += stats.processed;
+        total.rejected += stats.rejected;
+        total.fills += stats.fills;
+        total.queueFull += stats.queueFull;
+        total.cancelLane += stats.cancelLane;
+        total.deferred += stats.deferred;
+        total.fairnessTurns += stats.fairnessTurns;
+        total.coalesced += stats.coalesced;
+        total.queueDepth += stats.queueDepth;
+        total.maxQueueDepth = std::max(total.maxQueueDepth, stats.maxQueueDepth);
+        total.dutyCycle += stats.dutyCycle / workerCount();
+    }
+    return total;
+}
+
+void ShardedEngine::queueDelays(LatencyHistogram& cancels, LatencyHistogram& orders) const {
+    for (const auto& worker : workers_) {
+        cancels.merge(worker->cancelDelay);
+        orders.merge(worker->orderDelay);
+    }
+}
+
+void ShardedEngine::resetQueueDelays() {
+    for (auto& worker : workers_) {
+        worker->cancelDelay.reset();
+        worker->orderDelay.reset();
+    }
+}
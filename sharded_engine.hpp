@@ -0,0 +1,215 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include "book_manager.hpp"
+#include "command_queue.hpp"
+#include "engine_runner.hpp"
+#include "latency_histogram.hpp"
+
+// Multi-core engine that partitions instruments across pinned worker threads.
+//
+// Each worker exclusively owns the books of its instruments (a BookManager) and
+// consumes commands from its own lock-free queue, so a book's state only ever
+// lives in one core's cache and needs no lock at all. The router side
+// (submit/cancel/modify) can be called from any thread: it picks the worker from
+// the instrument ID and pushes the command, returning false if that worker's
+// queue is full. Commands for one instrument are applied in the order they were
+// pushed from a given thread.
+//
+// Books are created on their worker thread, so with first-touch placement their
+// memory lands on the worker's NUMA node. Workers are EngineRunners: they busy-poll
+// their queue and fall back to the configured idle strategy when it runs dry.
+//
+// With cancelLane set, each worker has a second queue for cancels and amends-down
+// that it drains ahead of new orders, so a maker pulling quotes during a burst
+// doesn't wait behind the burst. After cancelBurst of them in a row, a waiting
+// new order gets a turn. A cancel that overtakes its own order (the submit is
+// still queued) is held until that submit has been applied. Cancel-lane commands
+// may still overtake a plain Modify of the same order.
+
+// AmendDown is a Modify the sender declares risk-reducing (smaller quantity, or a
+// price moved away from the touch); it takes the cancel lane. The engine does not
+// check the claim.
+enum class CommandType : uint8_t { Submit, Cancel, Modify, AmendDown };
+
+struct EngineCommand {
+    CommandType  type;
+    InstrumentId instrument;
+    Order        order;   // Cancel uses order.id; Modify also takes the new priceTick and quantity
+    uint64_t     enqueuedNs = 0;   // Set by the router when measuring queue delay
+};
+
+// Applies one command to a manager's books; fills (cleared first) receive any trades
+bool applyCommand(BookManager& books, const EngineCommand& command, std::vector<Fill>& fills);
+
+// Collapses runs of amends/cancels on the same order within one batch of commands
+// into the run's final effect, so the book sees one command instead of several:
+//   amend, amend  -> the last amend        amend, cancel  -> cancel
+//   cancel, amend/cancel -> cancel (the later ones would be rejected anyway)
+// A submit reusing the order's ID ends its run. The surviving command keeps the
+// position of the last command in the run. Superseded amends are never applied, so
+// they cannot trade.
+class CommandCoalescer {
+public:
+    static constexpr size_t MAX_BATCH = 128;
+
+    // Sets skip[i] for every command superseded by a later one in commands[0..count)
+    // (count <= MAX_BATCH) and returns how many were
+    size_t coalesce(const EngineCommand* commands, size_t count, bool* skip);
+
+private:
+    static constexpr size_t TABLE_SIZE = MAX_BATCH * 2;
+    static constexpr uint32_t NO_RUN = UINT32_MAX;
+
+    struct Run {
+        uint64_t orderId;
+        uint32_t index;        // Current effective command, or NO_RUN after a submit
+        uint32_t stamp;        // Batch the slot belongs to
+    };
+
+    Run& slotFor(uint64_t orderId);
+
+    std::array<Run, TABLE_SIZE> runs_{};
+    uint32_t stamp_ = 0;
+};
+
+class ShardedEngine {
+public:
+    struct Options {
+        unsigned workers = 0;              // 0: one per CPU the process may use
+        size_t maxInstruments = 1024;      // Dense instrument IDs 0..maxInstruments-1
+        size_t queueCapacity = 1 << 16;    // Commands per worker queue (rounded up to a power of two)
+        size_t ordersPerBookHint = 0;
+        std::vector<int> cpus;             // Worker i runs on cpus[i % cpus.size()]; empty: the
+                                           // process's allowed CPUs, node by node
+        bool pinThreads = true;
+        IdleOptions idle;                  // What a worker does when its queue is empty
+        // Each book is touched only by its worker, so by default it takes no lock
+        ConcurrencyMode bookLocking = ConcurrencyMode::SingleThreaded;
+        bool cancelLane = false;           // Separate queue for cancels and amends-down
+        size_t cancelLaneCapacity = 1 << 14;
+        uint32_t cancelBurst = 16;         // Cancel-lane commands in a row before a new order gets a turn
+        bool measureQueueDelay = false;    // Timestamp commands and record push-to-apply delay
+        bool coalesce = false;             // Collapse repeated amends/cancels of one order per drain batch
+    };
+
+    // Called on the worker thread for every fill
+    using FillHandler = std::function<void(InstrumentId, const Fill&)>;
+
+    explicit ShardedEngine(const Options& options, FillHandler onFill = nullptr);
+    ~ShardedEngine();
+
+    ShardedEngine(const ShardedEngine&) = delete;
+    ShardedEngine& operator=(const ShardedEngine&) = delete;
+
+    // Router. Returns false when the owning worker's queue is full (or the engine is stopped).
+    bool submit(InstrumentId instrument, const Order& order);
+    bool cancel(InstrumentId instrument, uint64_t orderId);
+    bool modify(InstrumentId instrument, uint64_t orderId, int64_t newPrice, uint32_t newQty);
+    bool amendDown(InstrumentId instrument, uint64_t orderId, int64_t newPrice, uint32_t newQty);
+    bool push(const EngineCommand& command);   // Cancel and AmendDown take the cancel lane if enabled
+
+    unsigned workerCount() const { return static_cast<unsigned>(workers_.size()); }
+    unsigned workerOf(InstrumentId instrument) const {
+        return static_cast<unsigned>(instrument % workers_.size());
+    }
+
+    // Blocks until every command pushed so far has been applied
+    void waitIdle() const;
+
+    // Drains the queues and joins the workers; call once producers have stopped.
+    // Later pushes are rejected.
+    void stop();
+
+    struct WorkerStats {
+        int      cpu = -1;
+        uint32_t pinFailures = 0;  // Worker pinned to cpu was refused by the OS (total: count)
+        uint64_t processed = 0;    // Commands applied
+        uint64_t rejected = 0;     // Commands the book refused (unknown order, duplicate ID, FOK miss)
+        uint64_t fills = 0;
+        uint64_t queueFull = 0;    // Pushes refused because the queue was full
+        uint64_t cancelLane = 0;   // Commands taken from the cancel lane
+        uint64_t deferred = 0;     // Cancel-lane commands held until their order's submit was applied
+        uint64_t fairnessTurns = 0;        // New orders let through by the cancelBurst limit
+        uint64_t coalesced = 0;    // Amends/cancels dropped as superseded (counted in processed)
+        size_t   queueDepth = 0;
+        size_t   maxQueueDepth = 0;        // Largest sampled depth
+        double   dutyCycle = 0;            // Share of wall time spent applying commands (total: mean)
+    };
+    WorkerStats workerStats(unsigned worker) const;
+    WorkerStats totalStats() const;
+
+    // Push-to-apply delay over all workers (needs measureQueueDelay), split into
+    // cancels/amends-down and everything else, whichever queue they went through
+    void queueDelays(LatencyHistogram& cancels, LatencyHistogram& orders) const;
+    void resetQueueDelays();   // While idle
+
+    // A worker's books. Only read them while the engine is idle (after waitIdle) or stopped.
+    const BookManager& shard(unsigned worker) const { return workers_[worker]->books; }
+
+private:
+    static constexpr uint32_t DRAIN_BATCH = 64;    // Commands popped, then applied, per poll
+    static_assert(DRAIN_BATCH <= CommandCoalescer::MAX_BATCH);
+
+    struct Deferred {
+        EngineCommand command;
+        uint64_t horizon;      // Main-queue position by which its submit must have been applied
+    };
+
+    struct alignas(CACHE_LINE_BYTES) Worker {
+        Worker(size_t instruments, size_t ordersPerBookHint, size_t queueCapacity, size_t laneCapacity)
+            : queue(queueCapacity), cancels(laneCapacity), books(instruments, ordersPerBookHint) {
+            scratchFills.reserve(256);
+            deferred.reserve(64);
+        }
+
+        CommandQueue<EngineCommand> queue;
+        CommandQueue<EngineCommand> cancels;    // Cancel lane
+        BookManager books;
+        std::unique_ptr<EngineRunner> runner;
+        int cpu = -1;
+
+        // Worker thread only
+        std::array<EngineCommand, DRAIN_BATCH> batch;
+        std::array<bool, DRAIN_BATCH> batchFromLane;
+        std::array<bool, DRAIN_BATCH> batchSkip;
+        CommandCoalescer coalescer;
+        std::vector<Fill> scratchFills;
+        std::vector<Deferred> deferred;
+        uint32_t cancelRun = 0;                 // Cancel-lane commands applied since the last new order
+        uint64_t queueApplied = 0;              // Main-queue commands applied (or coalesced) so far
+        uint64_t processedLocal = 0, rejectedLocal = 0, fillsLocal = 0;
+        uint64_t cancelLaneLocal = 0, deferredLocal = 0, fairnessLocal = 0, coalescedLocal = 0;
+
+        // Written by the worker only
+        alignas(CACHE_LINE_BYTES) std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> rejected{0};
+        std::atomic<uint64_t> fills{0};
+        std::atomic<uint64_t> cancelLaneApplied{0};
+        std::atomic<uint64_t> deferredCount{0};
+        std::atomic<uint64_t> fairnessTurns{0};
+        std::atomic<uint64_t> coalesced{0};
+        LatencyHistogram cancelDelay, orderDelay;
+
+        // Written by producers
+        alignas(CACHE_LINE_BYTES) std::atomic<uint64_t> queueFull{0};
+    };
+
+    size_t poll(Worker& worker);
+    uint32_t popBatch(Worker& worker);
+    bool execute(Worker& worker, const EngineCommand& command, std::vector<Fill>& fills);
+    void apply(Worker& worker, const EngineCommand& command);
+    void applyFromQueue(Worker& worker, const EngineCommand& command);
+    void applyFromCancelLane(Worker& worker, const EngineCommand& command);
+    size_t expireDeferred(Worker& worker);
+
+    Options options_;
+    FillHandler fillCb_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> running_{true};
+};
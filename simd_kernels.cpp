@@ -0,0 +1,183 @@
+#include "simd_kernels.hpp"
+
+// The kernels use 64-bit lane extracts (_mm_extract_epi64, _mm_cvtsi128_si64), which
+// exist only on x86-64; 32-bit x86 and other targets take the scalar path
+#if defined(__x86_64__)
+#define HFT_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace HFTSimd {
+namespace {
+    uint64_t sumScalar(const uint32_t* qtys, uint32_t n) {
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < n; ++i) total += qtys[i];
+        return total;
+    }
+
+    // Finishes a prefix scan from index i one entry at a time
+    uint32_t prefixTail(const uint32_t* qtys, const uint32_t* owners, uint32_t i, uint32_t n,
+                        uint32_t excludeOwner, uint64_t target, uint64_t total, uint64_t& sum) {
+        for (; i < n; ++i) {
+            if (owners[i] == excludeOwner) continue;
+            total += qtys[i];
+            if (total >= target) {
+                sum = total;
+                return i;
+            }
+        }
+        sum = total;
+        return n;
+    }
+
+    uint32_t prefixScalar(const uint32_t* qtys, const uint32_t* owners, uint32_t n,
+                          uint32_t excludeOwner, uint64_t target, uint64_t& sum) {
+        return prefixTail(qtys, owners, 0, n, excludeOwner, target, 0, sum);
+    }
+
+#ifdef HFT_SIMD_X86
+    // Quantities are widened to 64-bit lanes before accumulating so large levels cannot overflow
+
+    __attribute__((target("sse4.1"), always_inline)) inline
+    uint64_t horizontalSum(__m128i v) {
+        return uint64_t(_mm_cvtsi128_si64(v)) + uint64_t(_mm_extract_epi64(v, 1));
+    }
+
+    __attribute__((target("sse4.1")))
+    uint64_t sumSse41(const uint32_t* qtys, uint32_t n) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc0 = zero;
+        __m128i acc1 = zero;
+        uint32_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m128i q0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(qtys + i));
+            __m128i q1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(qtys + i + 4));
+            acc0 = _mm_add_epi64(acc0, _mm_add_epi64(_mm_unpacklo_epi32(q0, zero), _mm_unpackhi_epi32(q0, zero)));
+            acc1 = _mm_add_epi64(acc1, _mm_add_epi64(_mm_unpacklo_epi32(q1, zero), _mm_unpackhi_epi32(q1, zero)));
+        }
+        return horizontalSum(_mm_add_epi64(acc0, acc1)) + sumScalar(qtys + i, n - i);
+    }
+
+    __attribute__((target("sse4.1")))
+    uint32_t prefixSse41(const uint32_t* qtys, const uint32_t* owners, uint32_t n,
+                         uint32_t excludeOwner, uint64_t target, uint64_t& sum) {
+        const __m128i exclude = _mm_set1_epi32(static_cast<int>(excludeOwner));
+        uint64_t total = 0;
+        uint32_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m128i q = _mm_loadu_si128(reinterpret_cast<const __m128i*>(qtys + i));
+            __m128i o = _mm_loadu_si128(reinterpret_cast<const __m128i*>(owners + i));
+            q = _mm_andnot_si128(_mm_cmpeq_epi32(o, exclude), q);
+            uint64_t block = horizontalSum(_mm_add_epi64(_mm_cvtepu32_epi64(q),
+                                                         _mm_cvtepu32_epi64(_mm_srli_si128(q, 8))));
+            if (total + block >= target) break;   // Target lies inside this block
+            total += block;
+        }
+        return prefixTail(qtys, owners, i, n, excludeOwner, target, total, sum);
+    }
+
+    __attribute__((target("avx2")))
+    uint64_t sumAvx2(const uint32_t* qtys, uint32_t n) {
+        __m256i acc0 = _mm256_setzero_si256();
+        __m256i acc1 = _mm256_setzero_si256();
+        uint32_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(qtys + i));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(qtys + i + 4));
+            acc0 = _mm256_add_epi64(acc0, _mm256_cvtepu32_epi64(lo));
+            acc1 = _mm256_add_epi64(acc1, _mm256_cvtepu32_epi64(hi));
+        }
+        __m256i acc = _mm256_add_epi64(acc0, acc1);
+        __m128i folded = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        return horizontalSum(folded) + sumScalar(qtys + i, n - i);
+    }
+
+    __attribute__((target("avx2")))
+    uint32_t prefixAvx2(const uint32_t* qtys, const uint32_t* owners, uint32_t n,
+                        uint32_t excludeOwner, uint64_t target, uint64_t& sum) {
+        const __m256i exclude = _mm256_set1_epi32(static_cast<int>(excludeOwner));
+        uint64_t total = 0;
+        uint32_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256i q = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(qtys + i));
+            __m256i o = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(owners + i));
+            q = _mm256_andnot_si256(_mm256_cmpeq_epi32(o, exclude), q);
+            __m256i wide = _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(q)),
+                                            _mm256_cvtepu32_epi64(_mm256_extracti128_si256(q, 1)));
+            uint64_t block = horizontalSum(_mm_add_epi64(_mm256_castsi256_si128(wide),
+                                                         _mm256_extracti128_si256(wide, 1)));
+            if (total + block >= target) break;   // Target lies inside this block
+            total += block;
+        }
+        return prefixTail(qtys, owners, i, n, excludeOwner, target, total, sum);
+    }
+#endif
+
+    using SumFn = uint64_t (*)(const uint32_t*, uint32_t);
+    using PrefixFn = uint32_t (*)(const uint32_t*, const uint32_t*, uint32_t, uint32_t, uint64_t, uint64_t&);
+
+    struct Dispatch {
+        Isa      isa = Isa::Scalar;
+        SumFn    sum = sumScalar;
+        PrefixFn prefix = prefixScalar;
+    };
+
+    Isa detect() {
+#ifdef HFT_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return Isa::AVX2;
+        if (__builtin_cpu_supports("sse4.1")) return Isa::SSE41;
+#endif
+        return Isa::Scalar;
+    }
+
+    Dispatch select(Isa isa) {
+        Dispatch d;
+#ifdef HFT_SIMD_X86
+        if (isa == Isa::AVX2) {
+            d = {Isa::AVX2, sumAvx2, prefixAvx2};
+        } else if (isa == Isa::SSE41) {
+            d = {Isa::SSE41, sumSse41, prefixSse41};
+        }
+#else
+        (void)isa;
+#endif
+        return d;
+    }
+
+    // Calls made during static initialisation of other translation units see the scalar defaults
+    Dispatch active = select(detect());
+}
+
+const char* isaName(Isa isa) {
+    switch (isa) {
+        case Isa::AVX2:  return "AVX2";
+        case Isa::SSE41: return "SSE4.1";
+        default:         return "scalar";
+    }
+}
+
+Isa detectedIsa() {
+    static const Isa detected = detect();
+    return detected;
+}
+
+Isa activeIsa() {
+    return active.isa;
+}
+
+Isa setIsa(Isa isa) {
+    if (isa > detectedIsa()) isa = detectedIsa();
+    active = select(isa);
+    return active.isa;
+}
+
+uint64_t sumQuantities(const uint32_t* qtys, uint32_t n) {
+    return active.sum(qtys, n);
+}
+
+uint32_t findFillPrefix(const uint32_t* qtys, const uint32_t* owners, uint32_t n,
+                        uint32_t excludeOwner, uint64_t target, uint64_t& sum) {
+    return active.prefix(qtys, owners, n, excludeOwner, target, sum);
+}
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+
+// Vectorised reductions over a level's contiguous quantity/owner arrays.
+// The implementation is chosen once at startup from the CPU's capabilities
+// (AVX2, then SSE4.1, then portable scalar) and can be overridden for testing.
+
+namespace HFTSimd {
+    enum class Isa : uint8_t { Scalar, SSE41, AVX2 };
+
+    const char* isaName(Isa isa);
+
+    // Best instruction set this CPU supports
+    Isa detectedIsa();
+
+    // Instruction set the kernels currently dispatch to
+    Isa activeIsa();
+
+    // Selects an implementation; requests above detectedIsa() are clamped.
+    // Not synchronised with concurrent kernel calls, so set it before trading starts.
+    Isa setIsa(Isa isa);
+
+    // Sum of n quantities
+    uint64_t sumQuantities(const uint32_t* qtys, uint32_t n);
+
+    // Scans quantities in order, skipping entries owned by excludeOwner, and returns
+    // the index of the entry at which the running sum first reaches target (n if it
+    // never does). sum receives the running total through that entry.
+    uint32_t findFillPrefix(const uint32_t* qtys, const uint32_t* owners, uint32_t n,
+                            uint32_t excludeOwner, uint64_t target, uint64_t& sum);
+}
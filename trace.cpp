@@ -0,0 +1,188 @@
+#include "trace.hpp"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+namespace HFTTrace {
+
+namespace {
+    // Each thread owns a single-writer ring; the oldest spans are overwritten
+    constexpr size_t RING_CAPACITY = 1 << 16;
+
+    struct Event {
+        uint64_t startNs;
+        uint64_t endNs;
+        uint64_t orderId;
+        Span     span;
+    };
+
+    // Slot fields are relaxed atomics so a dump can copy them while the owner records
+    struct Slot {
+        std::atomic<uint64_t> startNs{0};
+        std::atomic<uint64_t> endNs{0};
+        std::atomic<uint64_t> orderId{0};
+        std::atomic<Span>     span{Span::Submit};
+    };
+
+    // started is bumped before a slot is overwritten and written after, so a reader
+    // can tell which of the slots it copied may have been torn
+    struct ThreadBuffer {
+        uint32_t tid = 0;
+        std::atomic<uint64_t> started{0};
+        std::atomic<uint64_t> written{0};
+        std::unique_ptr<Slot[]> slots{new Slot[RING_CAPACITY]};
+    };
+
+    // Copies the spans of one ring that were complete and not overwritten during the copy
+    void snapshot(const ThreadBuffer& buffer, std::vector<Event>& out) {
+        out.clear();
+        uint64_t written = buffer.written.load(std::memory_order_acquire);
+        uint64_t first = written > RING_CAPACITY ? written - RING_CAPACITY : 0;
+        out.reserve(written - first);
+        for (uint64_t i = first; i < written; ++i) {
+            const Slot& slot = buffer.slots[i & (RING_CAPACITY - 1)];
+            out.push_back(Event{slot.startNs.load(std::memory_order_relaxed),
+                                slot.endNs.load(std::memory_order_relaxed),
+                                slot.orderId.load(std::memory_order_relaxed),
+                                slot.span.load(std::memory_order_relaxed)});
+        }
+        // Any overwrite we observed above is now covered by started
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t started = buffer.started.load(std::memory_order_relaxed);
+        if (started < written) {
+            out.clear();    // cleared mid-copy
+            return;
+        }
+        uint64_t intact = started > RING_CAPACITY ? started - RING_CAPACITY : 0;
+        if (intact > first) out.erase(out.begin(), out.begin() + std::min<uint64_t>(intact - first, out.size()));
+    }
+
+    // Buffers outlive their threads so spans can be dumped after workers exit
+    std::mutex& registryMutex() {
+        static std::mutex m;
+        return m;
+    }
+
+    std::vector<std::shared_ptr<ThreadBuffer>>& registry() {
+        static std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        return buffers;
+    }
+
+    ThreadBuffer& localBuffer() {
+        thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+            auto b = std::make_shared<ThreadBuffer>();
+            std::lock_guard<std::mutex> lock(registryMutex());
+            b->tid = static_cast<uint32_t>(registry().size() + 1);
+            registry().push_back(b);
+            return b;
+        }();
+        return *buffer;
+    }
+}
+
+const char* spanName(Span span) {
+    switch (span) {
+        case Span::Submit:      return "submitOrder";
+        case Span::Cancel:      return "cancelOrder";
+        case Span::LockAcquire: return "lockAcquire";
+        case Span::FokCheck:    return "fokCheck";
+        case Span::Match:       return "matchLoop";
+        case Span::Rest:        return "restOrder";
+        case Span::Callback:    return "fillCallback";
+        default:                return "unknown";
+    }
+}
+
+bool enabled() {
+#ifdef ORDERBOOK_TRACE
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+void record(Span span, uint64_t orderId, uint64_t startNs, uint64_t endNs) {
+    ThreadBuffer& buffer = localBuffer();
+    uint64_t seq = buffer.written.load(std::memory_order_relaxed);
+    buffer.started.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    Slot& slot = buffer.slots[seq & (RING_CAPACITY - 1)];
+    slot.startNs.store(startNs, std::memory_order_relaxed);
+    slot.endNs.store(endNs, std::memory_order_relaxed);
+    slot.orderId.store(orderId, std::memory_order_relaxed);
+    slot.span.store(span, std::memory_order_relaxed);
+    buffer.written.store(seq + 1, std::memory_order_release);
+}
+
+void writeChromeTrace(std::ostream& out) {
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        buffers = registry();
+    }
+
+    // Copy first; threads may keep recording while we format
+    std::vector<std::vector<Event>> events(buffers.size());
+    for (size_t t = 0; t < buffers.size(); ++t) snapshot(*buffers[t], events[t]);
+
+    // Rebase timestamps so the trace starts near zero
+    uint64_t base = UINT64_MAX;
+    for (const auto& spans : events) {
+        for (const Event& e : spans) base = std::min(base, e.startNs);
+    }
+    if (base == UINT64_MAX) base = 0;
+
+    std::ios_base::fmtflags savedFlags = out.flags();
+    std::streamsize savedPrecision = out.precision();
+    out << std::fixed << std::setprecision(3);
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool firstEvent = true;
+    for (size_t t = 0; t < buffers.size(); ++t) {
+        uint32_t tid = buffers[t]->tid;
+        out << (firstEvent ? "" : ",")
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+            << ",\"args\":{\"name\":\"thread " << tid << "\"}}";
+        firstEvent = false;
+
+        for (const Event& e : events[t]) {
+            out << ",{\"name\":\"" << spanName(e.span) << "\",\"cat\":\"orderbook\",\"ph\":\"X\""
+                << ",\"ts\":" << (e.startNs - base) / 1000.0
+                << ",\"dur\":" << (e.endNs - e.startNs) / 1000.0
+                << ",\"pid\":1,\"tid\":" << tid
+                << ",\"args\":{\"orderId\":" << e.orderId << "}}";
+        }
+    }
+    out << "]}\n";
+
+    out.flags(savedFlags);
+    out.precision(savedPrecision);
+}
+
+bool writeChromeTrace(const std::string& path) {
+    std::ofstream file(path);
+    if (!file) return false;
+    writeChromeTrace(file);
+    return static_cast<bool>(file);
+}
+
+void clear() {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    for (const auto& b : registry()) {
+        b->written.store(0, std::memory_order_release);
+        b->started.store(0, std::memory_order_release);
+    }
+}
+
+}
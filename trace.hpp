@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Per-order lifecycle tracing exported as Chrome trace JSON (chrome://tracing, Perfetto)
+// Compiled out unless ORDERBOOK_TRACE is defined; the TRACE_* macros then expand to nothing
+
+namespace HFTTrace {
+    enum class Span : uint8_t {
+        Submit,
+        Cancel,
+        LockAcquire,
+        FokCheck,
+        Match,
+        Rest,
+        Callback,
+        Count
+    };
+
+    const char* spanName(Span span);
+
+    // True when the library was built with ORDERBOOK_TRACE
+    bool enabled();
+
+    // Steady-clock timestamp used for all spans
+    uint64_t nowNs();
+
+    // Appends a completed span to the calling thread's ring buffer
+    void record(Span span, uint64_t orderId, uint64_t startNs, uint64_t endNs);
+
+    // Writes every thread's buffered spans as a Chrome trace document. Safe while
+    // threads are recording: each ring is copied first, and spans overwritten
+    // during the copy are dropped rather than emitted torn.
+    void writeChromeTrace(std::ostream& out);
+    bool writeChromeTrace(const std::string& path);
+
+    // Discards all buffered spans; spans recorded concurrently may survive
+    void clear();
+
+    // RAII span: records [construction, finish()/destruction) once
+    class Scope {
+    public:
+        Scope(Span span, uint64_t orderId) : span_(span), orderId_(orderId), start_(nowNs()) {}
+        ~Scope() { finish(); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        void finish() {
+            if (!done_) {
+                record(span_, orderId_, start_, nowNs());
+                done_ = true;
+            }
+        }
+
+    private:
+        Span     span_;
+        uint64_t orderId_;
+        uint64_t start_;
+        bool     done_ = false;
+    };
+}
+
+#ifdef ORDERBOOK_TRACE
+    #define TRACE_CONCAT_IMPL(a, b) a##b
+    #define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+    #define TRACE_SCOPE(span, orderId) \
+        HFTTrace::Scope TRACE_CONCAT(traceScope_, __LINE__)(HFTTrace::Span::span, (orderId))
+    #define TRACE_SCOPE_VAR(var, span, orderId) HFTTrace::Scope var(HFTTrace::Span::span, (orderId))
+    #define TRACE_FINISH(var) var.finish()
+#else
+    #define TRACE_SCOPE(span, orderId) ((void)0)
+    #define TRACE_SCOPE_VAR(var, span, orderId) ((void)0)
+    #define TRACE_FINISH(var) ((void)0)
+#endif